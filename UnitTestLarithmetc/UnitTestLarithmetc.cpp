@@ -1,6 +1,7 @@
 #include "pch.h"
 #include "CppUnitTest.h"
 #include "../larithmetic/crypto.cpp"
+#include <sstream>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -77,5 +78,762 @@ namespace UnitTestLarithmetc
 			BigInt a = BigInt("1522605027922533360535618378132637429718068114961380688657908494580122963258952897654000350692006139");
 			Assert::AreEqual(false, testPrimeMillerRabin(a,1));
 		}
+
+		TEST_METHOD(TestRandomEngine_chacha20Block) {
+			// RFC 7539, section 2.3.2
+			auto engine = RandomEngine({ 0x03020100, 0x07060504, 0x0b0a0908, 0x0f0e0d0c, 0x13121110, 0x17161514, 0x1b1a1918, 0x1f1e1d1c },
+				{ 0x09000000, 0x4a000000, 0x00000000 }, 1);
+			Assert::AreEqual(0xe4e7f110u, engine.next32());
+			Assert::AreEqual(0x15593bd1u, engine.next32());
+		}
+
+		TEST_METHOD(TestRandomEngine_uniformBelow) {
+			BigInt bound = BigInt("1000000000000000000007");
+			for (int i = 0; i < 100; i++) {
+				BigInt r = randBigInt(bound);
+				Assert::AreEqual(true, r >= 0 && r < bound);
+			}
+		}
+
+		TEST_METHOD(TestRandomEngine_fixedBits) {
+			BigInt low = BigInt(2).pow(99);
+			for (int i = 0; i < 20; i++) {
+				BigInt r = rand_num_fixed_bits(100);
+				Assert::AreEqual(true, r >= low && r < low * 2);
+				Assert::AreEqual(true, r.mod2() == 1);
+			}
+		}
+
+		TEST_METHOD(TestMontgomery_powMod) {
+			BigInt mod = BigInt("123426017006182806728593424683999798008235734137469123231828679");
+			BigInt a = BigInt("98765432109876543210");
+			BigInt e = BigInt("1234567890123");
+			MontgomeryContext ctx(mod);
+			Assert::AreEqual(true, ctx.powMod(a, e) == a.pow(&e, mod));
+		}
+
+		TEST_METHOD(TestSafePrime_64) {
+			BigInt p = rand_safe_prime_fixed_bits(64);
+			Assert::AreEqual(64LL, p.bitLength());
+			Assert::AreEqual(true, testPrimeMillerRabin(p, 10));
+			Assert::AreEqual(true, testPrimeMillerRabin((p - 1) / 2, 10));
+		}
+
+		TEST_METHOD(TestStrongPrime_128) {
+			BigInt p = rand_strong_prime_fixed_bits(128);
+			Assert::AreEqual(128LL, p.bitLength());
+			Assert::AreEqual(true, testPrimeMillerRabin(p, 10));
+		}
+
+		TEST_METHOD(TestRhoPollardDivisor_semiprime) {
+			BigInt p = BigInt("1000000007");
+			BigInt q = BigInt("998244353");
+			BigInt d = rhoPollardDivisor(p * q, 1000000, 1);
+			Assert::AreEqual(true, d == p || d == q);
+		}
+
+		TEST_METHOD(TestRhoPollardFactorization_primePowers) {
+			BigInt n = BigInt(3).pow(5) * BigInt("1000003").pow(2) * BigInt("4294967311");
+			auto factorization = rhoPollardFactorization(n);
+			BigInt product = 1;
+			for (auto el : factorization) {
+				Assert::AreEqual(true, testPrimeMillerRabin(el.first, 10));
+				product = product * el.first.pow(el.second);
+			}
+			Assert::AreEqual(true, product == n);
+		}
+
+		TEST_METHOD(TestBinaryGcd) {
+			BigInt a = BigInt("1000000007") * BigInt(2).pow(40) * 3;
+			BigInt b = BigInt("1000000007") * BigInt(2).pow(35) * 5;
+			Assert::AreEqual(true, binaryGcd(a, b) == BigInt("1000000007") * BigInt(2).pow(35));
+			Assert::AreEqual(true, binaryGcd(0, b) == b);
+		}
+
+		TEST_METHOD(TestPollardPM1Divisor_smoothFactor) {
+			// p - 1 = 2 * 50021 * (six primes below 1000)
+			BigInt p = BigInt("35728539496195079543");
+			BigInt q = BigInt("1040444304105825724765727");
+			Assert::AreEqual(true, pollardPM1Divisor(p * q, 1000, 100000) == p);
+		}
+
+		TEST_METHOD(TestEcmDivisor_12digitFactor) {
+			BigInt p = BigInt("103624582937");
+			BigInt q = BigInt("1040444304105825724765727");
+			BigInt d = ecmDivisor(p * q, 2000, 200000, 100);
+			Assert::AreEqual(true, d == p || d == q);
+		}
+
+		TEST_METHOD(TestEcmDivisor_smallB1) {
+			// B1 far below the stage 2 giant step
+			BigInt p = BigInt(1000003);
+			BigInt q = BigInt("1040444304105825724765727");
+			BigInt d = ecmDivisor(p * q, 200, 20000, 40);
+			Assert::AreEqual(true, d == p || d == q);
+		}
+
+		TEST_METHOD(TestSmoothDivisors_allFactorsSmooth) {
+			// every p - 1 and every group order is B1-smooth, so whole stages end in gcd = n
+			BigInt n = BigInt(1319) * BigInt(1621) * BigInt(1759) * BigInt(1993);
+			BigInt d = pollardPM1Divisor(n, 10000, 1000000);
+			Assert::AreEqual(true, d > 1 && d < n && n % d == 0);
+			d = ecmDivisor(n, 50000, 5000000, 300);
+			Assert::AreEqual(true, d > 1 && d < n && n % d == 0);
+			BigInt m = BigInt(1009) * BigInt(1013) * BigInt(1019) * BigInt(1021) * BigInt(1031);
+			Assert::AreEqual(true, euler(m) == BigInt(1008) * BigInt(1012) * BigInt(1018) * BigInt(1020) * BigInt(1030));
+		}
+
+		TEST_METHOD(TestSmoothDivisors_blockReplay) {
+			// every p - 1 and group order splits over the first 100 primes, so the first gcd block already ends in n
+			BigInt n = BigInt(1621) * BigInt(1759) * BigInt(1993);
+			BigInt d = pollardPM1Divisor(n, 10000, 20000);
+			Assert::AreEqual(true, d > 1 && d < n && n % d == 0);
+			for (int i = 0; i < 5; i++) {
+				d = ecmDivisor(n, 2000, 0, 1);
+				Assert::AreEqual(true, d > 1 && d < n && n % d == 0);
+			}
+		}
+
+		TEST_METHOD(TestParallelFactorization) {
+			BigInt n = BigInt(2).pow(3) * BigInt(7) * BigInt("1099511627791").pow(2) * BigInt("1099511627831") * BigInt("103624582937");
+			auto factorization = parallelFactorization(n, 4);
+			Assert::AreEqual(5, (int)factorization.size());
+			BigInt product = 1;
+			for (auto el : factorization) {
+				Assert::AreEqual(true, testPrimeMillerRabin(el.first, 10));
+				product = product * el.first.pow(el.second);
+			}
+			Assert::AreEqual(true, product == n);
+		}
+
+		TEST_METHOD(TestSiqsDivisor_40digits) {
+			BigInt p = BigInt("98936812917358800691");
+			BigInt q = BigInt("11888570237800257629");
+			BigInt d = siqsDivisor(p * q, 2);
+			Assert::AreEqual(true, d == p || d == q);
+		}
+
+		TEST_METHOD(TestFactorization_arithmeticFunctions) {
+			// 2^3 * 3^2 * 5 * 1000000007
+			Factorization f = factorize(BigInt("360000002520"));
+			Assert::AreEqual(4, (int)f.primes.size());
+			Assert::AreEqual(true, f.primes[3].first == BigInt("1000000007"));
+			Assert::AreEqual(true, euler(f) == BigInt(96) * BigInt("1000000006"));
+			Assert::AreEqual(true, mobius(f) == 0);
+			Assert::AreEqual(true, carmichael(f) == BigInt("6000000036"));
+			Assert::AreEqual(true, divisorCount(f) == 48);
+			Assert::AreEqual(true, divisorSum(f) == BigInt(15 * 13 * 6) * BigInt("1000000008"));
+			Assert::AreEqual(true, mobius(BigInt(30)) == -1);
+			Assert::AreEqual(true, euler(BigInt(1)) == 1);
+		}
+
+		TEST_METHOD(TestFactorizationCache_bounded) {
+			FactorizationCache cache(2);
+			cache.get(BigInt("1099511627791") * BigInt("1099511627831"));
+			cache.get(12);
+			cache.get(35);
+			Assert::AreEqual(2, (int)cache.size());
+			Assert::AreEqual(0, (int)cache.hits());
+			Factorization f = cache.get(35);
+			Assert::AreEqual(1, (int)cache.hits());
+			Assert::AreEqual(true, f.primes[0].first == 5 && f.primes[1].first == 7);
+			// 12 is now the least recently used and 7 pushes it out
+			cache.get(7);
+			cache.get(12);
+			Assert::AreEqual(1, (int)cache.hits());
+			cache.get(7);
+			Assert::AreEqual(2, (int)cache.hits());
+			Assert::AreEqual(2, (int)cache.size());
+		}
+
+		TEST_METHOD(TestRangeSieves_small) {
+			vector<long long> phi = eulerRange(1, 100000);
+			vector<long long> mu = mobiusRange(1, 100000);
+			vector<long long> spf = smallestPrimeFactorRange(1, 100000);
+			for (long long n = 1; n <= 100000; n += 997) {
+				long long expectedPhi = n, expectedMu = 1, expectedSpf = n == 1 ? 1 : 0, m = n;
+				for (long long p = 2; p * p <= m; p++) {
+					if (m % p == 0) {
+						expectedSpf = expectedSpf == 0 ? p : expectedSpf;
+						expectedPhi = expectedPhi / p * (p - 1);
+						expectedMu = -expectedMu;
+						m /= p;
+						if (m % p == 0) {
+							expectedMu = 0;
+						}
+						while (m % p == 0) {
+							m /= p;
+						}
+					}
+				}
+				if (m > 1) {
+					expectedSpf = expectedSpf == 0 ? m : expectedSpf;
+					expectedPhi = expectedPhi / m * (m - 1);
+					expectedMu = -expectedMu;
+				}
+				Assert::AreEqual(expectedPhi, phi[n - 1]);
+				Assert::AreEqual(expectedMu, mu[n - 1]);
+				Assert::AreEqual(expectedSpf, spf[n - 1]);
+			}
+		}
+
+		TEST_METHOD(TestRangeSieves_segmentsAndThreads) {
+			long long from = 1000000000000LL;
+			long long to = from + 100000;
+			vector<long long> phi(to - from + 1);
+			mutex guard;
+			long long calls = 0;
+			eulerRange(from, to, [&](long long first, const vector<long long>& values) {
+				unique_lock<mutex> lock(guard);
+				calls++;
+				copy(values.begin(), values.end(), phi.begin() + (first - from));
+			}, 3);
+			Assert::AreEqual(true, calls > 1);
+			for (long long n = from; n <= to; n += 9973) {
+				Assert::AreEqual(true, euler(BigInt(n)) == phi[n - from]);
+			}
+			vector<long long> mu = mobiusRange(from, to);
+			for (long long n = from + 1; n <= to; n += 9973) {
+				Assert::AreEqual(true, mobius(BigInt(n)) == mu[n - from]);
+			}
+		}
+
+		TEST_METHOD(TestBabyStepGiantStepLog) {
+			BigInt p = BigInt("1000000007");
+			BigInt b = BigInt(5).powBySimpleMod(BigInt("123456789"), p);
+			BigInt x = babyStepGiantStepLog(5, b, p);
+			Assert::AreEqual(true, BigInt(5).powBySimpleMod(x, p) == b);
+			Assert::AreEqual(true, babyStepGiantStepLog(5, 1, p) == 0);
+			// Montgomery arithmetic needs an odd modulus
+			bool thrown = false;
+			try {
+				babyStepGiantStepLog(3, 5, 1000000);
+			}
+			catch (const char*) {
+				thrown = true;
+			}
+			Assert::AreEqual(true, thrown);
+		}
+
+		TEST_METHOD(TestBabyStepGiantStepLog_memoryCap) {
+			// 2^48 + 21 is prime, the 4KB cap leaves 128 baby steps
+			BigInt p = BigInt(2).pow(48) + 21;
+			BigInt x = BigInt("1234567");
+			BigInt b = BigInt(3).powBySimpleMod(x, p);
+			Assert::AreEqual(true, babyStepGiantStepLog(3, b, p, BigInt("2000000"), 4096) == x);
+			Assert::AreEqual(true, babyStepGiantStepLog(3, b, p, BigInt("1000000"), 4096) == -1);
+		}
+
+		TEST_METHOD(TestRhoPollardLog_primeOrder) {
+			// p = 2q + 1 with q prime, 4 generates the subgroup of order q
+			BigInt p = BigInt("2199023255867");
+			BigInt q = BigInt("1099511627933");
+			BigInt x = BigInt("987654321987");
+			BigInt h = BigInt(4).powBySimpleMod(x, p);
+			Assert::AreEqual(true, rhoPollardLog(4, h, p, q, 3) == x);
+		}
+
+		TEST_METHOD(TestKangarooLog_interval) {
+			BigInt p = BigInt("2199023255867");
+			BigInt x = BigInt("1000000123456");
+			BigInt h = BigInt(4).powBySimpleMod(x, p);
+			BigInt log = kangarooLog(4, h, p, BigInt("1000000000000"), BigInt("1000100000000"), 2);
+			Assert::AreEqual(true, log == x);
+		}
+
+		TEST_METHOD(TestSolveSimpleSystem_primePowers) {
+			// x = 3 mod 8, x = 5 mod 9, 2x = 1 mod 25
+			auto solution = solveSimpleSystem({ { 1, 3, 8 }, { 1, 5, 9 }, { 2, 1, 25 } });
+			Assert::AreEqual(true, solution.first == 563);
+			Assert::AreEqual(true, solution.second == 1800);
+		}
+
+		TEST_METHOD(TestPohligHellmanLog_smoothOrder) {
+			// p - 1 = 2^6 * 3^3 * 443 * 461 * 1319 * 1621 * 1759 * 1993 * 268438969, 7 is a primitive root
+			BigInt p = BigInt("710059758579962959475454562369");
+			BigInt x = BigInt("689177180917632131884873333902");
+			BigInt h = BigInt("528165424716711211588083725474");
+			Assert::AreEqual(true, pohligHellmanLog(7, h, p, 2) == x);
+			Assert::AreEqual(true, pohligHellmanLog(7, 1, p) == 0);
+		}
+
+		TEST_METHOD(TestKronecker) {
+			Assert::AreEqual(-1, kronecker(1001, 9907));
+			Assert::AreEqual(1, kronecker(19, 45));
+			Assert::AreEqual(-1, kronecker(8, 21));
+			Assert::AreEqual(1, kronecker(-7, 30));
+			Assert::AreEqual(-1, kronecker(7, -30));
+			Assert::AreEqual(1, kronecker(-3, -8));
+			Assert::AreEqual(0, kronecker(6, 15));
+			Assert::AreEqual(-1, kronecker(BigInt(2).pow(127) + 1, BigInt(2).pow(89) - 1));
+			Assert::AreEqual(0, kronecker(BigInt("123456789123456789"), BigInt("3000000000000000009")));
+			Assert::AreEqual(1, kronecker(-123456789, BigInt(2).pow(61) - 1));
+		}
+
+		TEST_METHOD(TestLegendre_eulerCriterion) {
+			BigInt p = BigInt("1000000007");
+			for (long long a = 1; a < 200; a += 7) {
+				BigInt euler = BigInt(a).powBySimpleMod((p - 1) / 2, p);
+				Assert::AreEqual(true, legendre(a, p) == (euler == 1 ? 1 : -1));
+			}
+			Assert::AreEqual(true, legendre(p * 3, p) == 0);
+		}
+
+		TEST_METHOD(TestSqrtMod_allMethods) {
+			// 3 mod 4, 5 mod 8, Tonelli-Shanks with s = 3, Cipolla with s = 23 and s = 30
+			vector<BigInt> primes = { BigInt("1000000007"), BigInt(2).pow(255) - 19, BigInt("1000000009"), BigInt("998244353"), BigInt("3221225473") };
+			for (BigInt p : primes) {
+				for (long long a = 2; a < 40; a += 3) {
+					BigInt square = BigInt(a).mulBySimpleMod(BigInt(a), p);
+					BigInt r = sqrtMod(square, p);
+					Assert::AreEqual(true, r.mulBySimpleMod(r, p) == square);
+					Assert::AreEqual(true, r <= p - r);
+					BigInt nonResidue = (square * 3).mathMod(p);
+					if (legendre(nonResidue, p) == -1) {
+						Assert::AreEqual(true, sqrtMod(nonResidue, p) == -1);
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(TestSqrtMod_batchAndCipolla) {
+			BigInt p = BigInt("998244353");
+			vector<BigInt> values = { 0, 1, 4, 5, 9, 12345, 678910 };
+			vector<BigInt> roots = sqrtMod(values, p);
+			for (long long i = 0; i < (long long)values.size(); i++) {
+				Assert::AreEqual(true, roots[i] == sqrtMod(values[i], p));
+			}
+			auto pair = cipolla(4, BigInt("1000000009"));
+			Assert::AreEqual(true, pair.first.mulBySimpleMod(pair.first, BigInt("1000000009")) == 4);
+			Assert::AreEqual(true, pair.first + pair.second == BigInt("1000000009"));
+		}
+
+		TEST_METHOD(TestKaratsuba_unbalanced) {
+			BigInt x = BigInt(3).pow(2000) - 1;
+			BigInt y = BigInt(7).pow(700) + 12345;
+			Assert::AreEqual(true, karatsuba(x, y) == x * y);
+			Assert::AreEqual(true, karatsuba(-x, x) == -(x * x));
+			Assert::AreEqual(true, karatsuba(x, 0) == 0);
+		}
+
+		TEST_METHOD(TestMontgomery_reduce) {
+			BigInt m = BigInt("1000000000000000000000007");
+			MontgomeryContext ctx(m);
+			BigInt x = BigInt(3).pow(500) + 17;
+			Assert::AreEqual(true, ctx.reduce(x) == x % m);
+			Assert::AreEqual(true, ctx.reduce(-x) == (-x).mathMod(m));
+		}
+
+		TEST_METHOD(TestCrtContext_garnerAndTree) {
+			BigInt x = BigInt(3).pow(700) + 11;
+			for (long long count : { 4, 40 }) {
+				vector<BigInt> moduli = { 32 };
+				vector<BigInt> residues = { x.modSmall(32) };
+				for (long long p = 1000000007; (long long)moduli.size() < count; p += 2) {
+					if (testPrimeMillerRabin(p, 10)) {
+						moduli.push_back(p);
+						residues.push_back(x.modSmall(p));
+					}
+				}
+				CrtContext ctx(moduli);
+				BigInt expected = x % ctx.getProduct();
+				Assert::AreEqual(true, ctx.reconstruct(residues) == expected);
+				auto many = ctx.reconstruct(vector<vector<BigInt>>{ residues, residues }, 2);
+				Assert::AreEqual(true, many[1] == expected);
+			}
+		}
+
+		TEST_METHOD(TestBatchGcd_sharedPrimes) {
+			// 0 and 2 share p0, 2 and 7 share p4, 3 and 7 share p5
+			string keys =
+				"67502083847044127709609317720844473178268748261756538744465114119399772822029\n"
+				"72409463464576038448601764640802933180010651081287837991256245267599708114197\n"
+				"102043636641028104023269853416458276255776937922570915992902576136831012884579\n"
+				"71176580547872868252705397079643896857378374241855948896257532092135178551147\n"
+				"29435845828388186222517545135838196039550846991993987177702553472911963325543\n"
+				"90281861725635285534687621435468720056390741186689971488973864944722561749287\n"
+				"93982532012964502575038923262280285596140511488876678872718070727629390508703\n"
+				"77188877665898095038422583520869546317236065950479046199277987684620208303193\n";
+			stringstream input(keys);
+			vector<BigInt> gcds = batchGcd(input, 2);
+			Assert::AreEqual(8, (int)gcds.size());
+			Assert::AreEqual(true, gcds[0] == BigInt("331189491551903988176639918851501444261"));
+			Assert::AreEqual(true, gcds[3] == BigInt("250521698257003095518434152828869473087"));
+			Assert::AreEqual(true, gcds[2] == BigInt("102043636641028104023269853416458276255776937922570915992902576136831012884579"));
+			for (int i : { 1, 4, 5, 6 }) {
+				Assert::AreEqual(true, gcds[i] == 1);
+			}
+
+			// chunks of three: the shared primes of 2 and 7 and of 3 and 7 cross chunks
+			stringstream chunked(keys);
+			vector<BigInt> chunkedGcds = batchGcd(chunked, 2, 3);
+			Assert::AreEqual(8, (int)chunkedGcds.size());
+			for (int i = 0; i < 8; i++) {
+				Assert::AreEqual(true, chunkedGcds[i] == gcds[i]);
+			}
+		}
+
+		TEST_METHOD(TestKaratsuba_nttTier) {
+			// all-nines operands drive every convolution coefficient to its maximum
+			string nines(9 * 3000, '9');
+			BigInt a(nines), b(nines.substr(5));
+			Assert::AreEqual(true, karatsuba(a, b) == a * b);
+			BigInt x(1), y(1);
+			for (int i = 0; i < 400; i++) {
+				x = x * BigInt("987654321987654321");
+				y = y * BigInt("123456789123456791");
+			}
+			Assert::AreEqual(true, karatsuba(x, y) == x * y);
+			Assert::AreEqual(true, karatsuba(-x, y) == -(x * y));
+		}
+
+		TEST_METHOD(TestElGamal_jacobianMatchesAffine) {
+			ElGamal curve;
+			Point P = curve.getP();
+			// affine double-and-add through addPoints as the reference
+			BigInt k("123456789");
+			Point expected(true), base = P;
+			for (BigInt e = k; e > 0; e = e / 2) {
+				if (e.mod2() == 1) {
+					expected = curve.addPoints(expected, base);
+				}
+				base = curve.addPoints(base, base);
+			}
+			Point kP = curve.mulPoint(k, P);
+			Assert::AreEqual(true, kP == expected);
+
+			BigInt order = hexToBigInt("DB7C2ABF62E35E7628DFAC6561C5");
+			Assert::AreEqual(true, curve.mulPoint(-k, P) == curve.mulPoint(order - k, P));
+			Assert::AreEqual(true, curve.addPoints(curve.mulPoint(-k, P), kP) == Point(true));
+			Assert::AreEqual(true, curve.mulPoint(order, P) == Point(true));
+		}
+
+		TEST_METHOD(TestElGamal_encryptDecrypt) {
+			ElGamal curve;
+			BigInt secret = curve.getRandomSecretKey();
+			Point Y = curve.mulPoint(secret, curve.getP());
+			Point M = curve.mulPoint(987654321, curve.getP());
+			Assert::AreEqual(true, curve.decrypt(curve.encrypt(M, Y), secret) == M);
+		}
+		TEST_METHOD(TestElGamal_generatorComb) {
+			ElGamal curve;
+			Point P = curve.getP();
+			Point Q = curve.addPoints(P, P);
+			BigInt order = hexToBigInt("DB7C2ABF62E35E7628DFAC6561C5");
+			// Q is not the generator, so this goes through the generic double-and-add
+			for (BigInt k : { BigInt(1), BigInt(2), BigInt(63), BigInt("1234567890123456789012345"), order - 1 }) {
+				Assert::AreEqual(true, curve.mulPoint(2 * k, P) == curve.mulPoint(k, Q));
+			}
+			Assert::AreEqual(true, curve.mulPoint(order, P) == Point(true));
+			Assert::AreEqual(true, curve.mulPoint(order + 5, P) == curve.mulPoint(5, P));
+
+			string path = "elgamal_comb_test.txt";
+			curve.saveGeneratorTable(path);
+			ElGamal loaded;
+			Assert::AreEqual(true, loaded.loadGeneratorTable(path));
+			Assert::AreEqual(true, loaded.mulPoint(order - 7, P) == curve.mulPoint(order - 7, P));
+			ElGamal other(BigInt(10007), 1, 3, 10007, Point(1, 1));
+			Assert::AreEqual(false, other.loadGeneratorTable(path));
+
+			// the right header over a damaged table: an entry off the curve, entry 1 not P, every entry but P negated
+			vector<string> lines;
+			ifstream in(path);
+			for (string line; getline(in, line); ) {
+				lines.push_back(line);
+			}
+			in.close();
+			BigInt p = (BigInt(2).pow(128) - 3) / 76439;
+			auto entry = [&](size_t i) {
+				stringstream row(lines[i]);
+				BigInt x, y;
+				row >> x >> y;
+				return make_pair(x, y);
+			};
+			auto damaged = [&](size_t i, const string& line) {
+				vector<string> copy = lines;
+				copy[i] = line;
+				return copy;
+			};
+			stringstream offCurve;
+			offCurve << entry(5).first << " " << entry(5).second + 1;
+			vector<string> negated = lines;
+			for (size_t i = 2; i < lines.size(); i++) {
+				stringstream row;
+				row << entry(i).first << " " << p - entry(i).second;
+				negated[i] = row.str();
+			}
+			for (auto table : { damaged(5, offCurve.str()), damaged(1, lines[2]), negated }) {
+				ofstream out(path);
+				for (auto& line : table) {
+					out << line << "\n";
+				}
+				out.close();
+				ElGamal tampered;
+				Assert::AreEqual(false, tampered.loadGeneratorTable(path));
+				Assert::AreEqual(true, tampered.mulPoint(order - 7, P) == curve.mulPoint(order - 7, P));
+			}
+			remove(path.c_str());
+		}
+		TEST_METHOD(TestElGamal_wnafAndLadder) {
+			ElGamal curve;
+			Point P = curve.getP();
+			Point Q = curve.addPoints(P, P);
+			BigInt order = hexToBigInt("DB7C2ABF62E35E7628DFAC6561C5");
+			// runs of ones and a top digit that carries out exercise the NAF recoding
+			Point sum(true);
+			for (int k = 1; k <= 20; k++) {
+				sum = curve.addPoints(sum, Q);
+				Assert::AreEqual(true, curve.mulPoint(k, Q) == sum);
+				Assert::AreEqual(true, curve.mulPointLadder(k, Q) == sum);
+			}
+			for (BigInt k : { BigInt("4294967295"), BigInt("18446744073709551615"), BigInt("1234567890123456789012345"), order - 1 }) {
+				Point expected = curve.mulPoint(2 * k, P);
+				Assert::AreEqual(true, curve.mulPoint(k, Q) == expected);
+				Assert::AreEqual(true, curve.mulPointLadder(k, Q) == expected);
+				Assert::AreEqual(true, curve.mulPointLadder(k, P) == curve.mulPoint(k, P));
+			}
+			Assert::AreEqual(true, curve.mulPointLadder(0, Q) == Point(true));
+			Assert::AreEqual(true, curve.mulPointLadder(order, Q) == Point(true));
+		}
+		TEST_METHOD(TestFixedField_matchesBigInt) {
+			typedef FixedField<DefaultElGamalCurve> Field;
+			BigInt p = (BigInt(2).pow(128) - 3) / 76439;
+			Assert::AreEqual(true, Field::getMod() == p);
+			Field f(p);
+			BigInt x = hexToBigInt("DB7C2ABF62E35E668076BEAD2088"), y = hexToBigInt("659EF8BA043916EEDE8911702B22");
+			for (int i = 0; i < 20; i++) {
+				Field::Element fx = f.toMont(x), fy = f.toMont(y);
+				Assert::AreEqual(true, f.fromMont(f.mul(fx, fy)) == x * y % p);
+				Assert::AreEqual(true, f.fromMont(f.add(fx, fy)) == (x + y) % p);
+				Assert::AreEqual(true, f.fromMont(f.sub(fx, fy)) == (x - y).mathMod(p));
+				Assert::AreEqual(true, f.fromMont(f.sub(fy, fx)) == (y - x).mathMod(p));
+				x = (x * x + 1) % p;
+				y = (y * 3 + x) % p;
+			}
+			Assert::AreEqual(true, f.fromMont(f.pow(f.toMont(x), p - 2)) * x % p == 1);
+			Assert::AreEqual(true, f.fromMont(f.toMont(p - 1)) == p - 1);
+			Assert::AreEqual(true, f.fromMont(f.add(f.toMont(p - 1), f.toMont(p - 1))) == p - 2);
+			Assert::AreEqual(true, f.fromMont(f.toMont(-1)) == p - 1);
+		}
+
+		TEST_METHOD(TestElGamal_genericField) {
+			// p = 10007 is not the default modulus, so this curve runs on MontgomeryContext
+			Point G(1, 1973);
+			ElGamal curve(10007, 2, 3, 4923, G);
+			Point Q = curve.addPoints(G, G);
+			Point sumG(true), sumQ(true);
+			for (int k = 1; k <= 30; k++) {
+				sumG = curve.addPoints(sumG, G);
+				sumQ = curve.addPoints(sumQ, Q);
+				Assert::AreEqual(true, curve.mulPoint(k, G) == sumG);
+				Assert::AreEqual(true, curve.mulPoint(k, Q) == sumQ);
+				Assert::AreEqual(true, curve.mulPointLadder(k, Q) == sumQ);
+			}
+			Assert::AreEqual(true, curve.mulPoint(4923, G) == Point(true));
+			Point Y = curve.mulPoint(77, G);
+			Assert::AreEqual(true, curve.decrypt(curve.encrypt(Q, Y), 77) == Q);
+			Assert::AreEqual(true, curve.decodePoint(curve.encodePoint(Y)) == Y);
+			Assert::AreEqual(true, curve.decodePoint(curve.encodePoint(-Y)) == curve.mulPoint(-77, G));
+
+			// the group has a cofactor; points outside <G> must not have their scalar reduced mod 4923
+			int outside = 0;
+			for (long long x = 2; x < 200 && outside < 10; x++) {
+				long long rhs = (x * x % 10007 * x + 2 * x + 3) % 10007;
+				long long y = 1;
+				while (y < 10007 && y * y % 10007 != rhs) {
+					y++;
+				}
+				Point R(x, y);
+				if (y == 10007 || curve.mulPoint(4923, R) == Point(true)) {
+					continue;
+				}
+				outside++;
+				for (BigInt k : { BigInt(5), BigInt(4923), BigInt(4924), BigInt(123456) }) {
+					Assert::AreEqual(true, curve.mulPointLadder(k, R) == curve.mulPoint(k, R));
+				}
+			}
+			Assert::AreEqual(10, outside);
+		}
+		TEST_METHOD(TestElGamal_batch) {
+			ElGamal curve;
+			BigInt secret("987654321987654321987654321"), other("12345");
+			Point Y = curve.mulPoint(secret, curve.getP());
+			vector<Point> messages;
+			for (int i = 1; i <= 37; i++) {
+				messages.push_back(curve.mulPoint(1000 + i, curve.getP()));
+			}
+			messages.push_back(Point(true));
+
+			auto c = curve.encryptBatch(messages, Y, 3);
+			Assert::AreEqual(messages.size(), c.size());
+			vector<Point> decrypted = curve.decryptBatch(c, secret, 3);
+			for (size_t i = 0; i < messages.size(); i++) {
+				Assert::AreEqual(true, decrypted[i] == messages[i]);
+				Assert::AreEqual(true, curve.decrypt(c[i], secret) == messages[i]);
+			}
+			// a new recipient key replaces the cached table
+			Point Z = curve.mulPoint(other, curve.getP());
+			auto d = curve.encryptBatch(messages, Z, 1);
+			Assert::AreEqual(true, curve.decryptBatch(d, other, 2)[5] == messages[5]);
+			Assert::AreEqual(true, curve.encryptBatch({}, Z).empty());
+		}
+		TEST_METHOD(TestElGamal_multiScalarMul) {
+			ElGamal curve;
+			Point P = curve.getP();
+			vector<BigInt> k;
+			vector<Point> points;
+			Point expected(true);
+			BigInt x("31415926535897932384626433");
+			for (int i = 0; i < 40; i++) {
+				// repeated bases, negative and zero scalars and the point at infinity all go through the buckets
+				Point base = i % 7 == 6 ? Point(true) : curve.mulPoint(i % 5 + 2, P);
+				x = (x * x + 7) % BigInt("5192296858534827628530496329220095");
+				BigInt ki = i % 9 == 4 ? BigInt(0) : i % 3 == 1 ? -x : x;
+				k.push_back(ki);
+				points.push_back(base);
+				expected = curve.addPoints(expected, curve.mulPoint(ki, base));
+				if (i == 1 || i == 2) {
+					Assert::AreEqual(true, curve.multiScalarMul(k, points) == expected);
+				}
+			}
+			Assert::AreEqual(true, curve.multiScalarMul(k, points, 3) == expected);
+			Assert::AreEqual(true, curve.multiScalarMul({}, {}) == Point(true));
+			BigInt order = hexToBigInt("DB7C2ABF62E35E7628DFAC6561C5");
+			Assert::AreEqual(true, curve.multiScalarMul({ order - 1, BigInt(1) }, { P, P }) == Point(true));
+		}
+		TEST_METHOD(TestElGamal_pointEncoding) {
+			ElGamal curve;
+			Point P = curve.getP();
+			vector<unsigned char> compressed = curve.encodePoint(P);
+			Assert::AreEqual((size_t)15, compressed.size());
+			Assert::AreEqual(0x02, (int)compressed[0]);
+			Assert::AreEqual(0x09, (int)compressed[1]);
+			Assert::AreEqual(0x98, (int)compressed[14]);
+			Assert::AreEqual(true, curve.decodePoint(compressed) == P);
+			vector<unsigned char> uncompressed = curve.encodePoint(P, false);
+			Assert::AreEqual((size_t)29, uncompressed.size());
+			Assert::AreEqual(0x04, (int)uncompressed[0]);
+			Assert::AreEqual(true, curve.decodePoint(uncompressed) == P);
+
+			// -P has the other parity
+			Point Q = curve.mulPoint(hexToBigInt("DB7C2ABF62E35E7628DFAC6561C5") - 1, P);
+			Assert::AreEqual(0x03, (int)curve.encodePoint(Q)[0]);
+			Assert::AreEqual(true, curve.decodePoint(curve.encodePoint(Q)) == Q);
+			Assert::AreEqual(true, curve.decodePoint(curve.encodePoint(-P)) == Q);
+			for (int k = 2; k < 20; k++) {
+				Point R = curve.mulPoint(k, P);
+				Assert::AreEqual(true, curve.decodePoint(curve.encodePoint(R)) == R);
+			}
+			Assert::AreEqual(true, curve.decodePoint(curve.encodePoint(Point(true))) == Point(true));
+
+			Assert::AreEqual(true, curve.isOnCurve(P));
+			Assert::AreEqual(false, curve.isOnCurve(Point(P.getX(), P.getY() + 1)));
+			uncompressed[28] ^= 1;
+			bool thrown = false;
+			try {
+				curve.decodePoint(uncompressed);
+			}
+			catch (const char*) {
+				thrown = true;
+			}
+			Assert::AreEqual(true, thrown);
+			// no point on the curve has x = 2
+			thrown = false;
+			try {
+				compressed.assign(15, 0);
+				compressed[0] = 0x02;
+				compressed[14] = 2;
+				curve.decodePoint(compressed);
+			}
+			catch (const char*) {
+				thrown = true;
+			}
+			Assert::AreEqual(true, thrown);
+		}
+		TEST_METHOD(TestMultiPowMod) {
+			BigInt mod("170141183460469231731687303715884105727");
+			MontgomeryContext ctx(mod);
+			vector<BigInt> bases = { BigInt("123456789123456789"), BigInt(2), BigInt("98765432109876543210"), BigInt(-5), mod + 3 };
+			vector<BigInt> exponents = { BigInt("340282366920938463463374607431768211455"), BigInt(65537), BigInt(0),
+				BigInt("1234567890123456789"), BigInt("77777777777777777777777777") };
+			for (size_t count = 1; count <= bases.size(); count++) {
+				vector<BigInt> b(bases.begin(), bases.begin() + count), e(exponents.begin(), exponents.begin() + count);
+				BigInt expected = 1;
+				for (size_t i = 0; i < count; i++) {
+					expected = expected * ctx.powMod(b[i].mathMod(mod), e[i]) % mod;
+				}
+				Assert::AreEqual(true, multiPowMod(b, e, mod) == expected);
+			}
+			// g^a y^-a = 1 for y = g
+			Assert::AreEqual(true, multiPowMod({ 7, 7 }, { BigInt("1000000007"), BigInt("-1000000007") }, mod) == 1);
+			Assert::AreEqual(true, multiPowMod({ 3, 5 }, { 4, 3 }, 1000) == 81 * 125 % 1000);
+			Assert::AreEqual(true, multiPowMod({}, {}, mod) == 1);
+		}
+		TEST_METHOD(TestSha256) {
+			auto hex = [](const vector<unsigned char>& bytes) {
+				stringstream out;
+				for (unsigned char byte : bytes) {
+					out << "0123456789abcdef"[byte >> 4] << "0123456789abcdef"[byte & 15];
+				}
+				return out.str();
+			};
+			auto bytes = [](const string& s) {
+				return vector<unsigned char>(s.begin(), s.end());
+			};
+			Assert::AreEqual(string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"), hex(sha256({})));
+			Assert::AreEqual(string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"), hex(sha256(bytes("abc"))));
+			Assert::AreEqual(string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"),
+				hex(sha256(bytes("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))));
+		}
+
+		TEST_METHOD(TestOaepBlocks) {
+			string message;
+			for (int i = 0; i < 300; i++) {
+				message += (char)(i * 37 + 11);
+			}
+			for (BigInt n : { BigInt(2).pow(127) - 1, BigInt(2).pow(1023) + 1 }) {
+				vector<BigInt> blocks = oaepEncodeBlocks(message, n);
+				for (BigInt& block : blocks) {
+					Assert::AreEqual(true, block < n);
+				}
+				Assert::AreEqual(message, oaepDecodeBlocks(blocks, n));
+				Assert::AreEqual(string(""), oaepDecodeBlocks(oaepEncodeBlocks("", n), n));
+				Assert::AreEqual(string("x"), oaepDecodeBlocks(oaepEncodeBlocks("x", n), n));
+			}
+			// 1023-bit modulus: 127-byte blocks, 32-byte hash, 62 bytes of data each
+			BigInt n = BigInt(2).pow(1023) + 1;
+			vector<BigInt> blocks = oaepEncodeBlocks(message, n);
+			Assert::AreEqual(5, (int)blocks.size());
+			Assert::AreEqual(5, (int)oaepEncodeBlocks(string(310, 'a'), n).size());
+			Assert::AreEqual(6, (int)oaepEncodeBlocks(string(311, 'a'), n).size());
+			swap(blocks[1], blocks[2]);
+			bool thrown = false;
+			try {
+				oaepDecodeBlocks(blocks, n);
+			}
+			catch (const char*) {
+				thrown = true;
+			}
+			Assert::AreEqual(true, thrown);
+		}
+		TEST_METHOD(TestGarnerRecombination) {
+			// RsaCrtContext is what RSA::decypher_int runs: c^d_p mod p and c^d_q mod q recombined over {q, p}
+			for (auto bits : vector<pair<int, int>>{ { 61, 89 }, { 107, 127 }, { 521, 607 } }) {
+				BigInt p = BigInt(2).pow(bits.first) - 1;
+				BigInt q = BigInt(2).pow(bits.second) - 1;
+				BigInt n = p * q;
+				BigInt e = 65537;
+				BigInt d = reverse_modulo(e, (p - 1) * (q - 1));
+				MontgomeryContext ctxN(n);
+				RsaCrtContext crt(p, q, d);
+				// p + 1 gives m_p = 1 < m_q, q + 1 gives m_q = 1 < m_p
+				for (BigInt m : { p + 1, q + 1, BigInt(2), BigInt("123456789123456789"), n - 1 }) {
+					BigInt c = ctxN.powMod(m, e);
+					BigInt back = crt.decrypt(c);
+					Assert::AreEqual(true, back == m);
+					Assert::AreEqual(true, back == ctxN.powMod(c, d));
+				}
+			}
+		}
 	};
 }
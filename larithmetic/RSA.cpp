@@ -1,10 +1,5 @@
 #include "RSA.h"
 #include <chrono>
-#include <random>
-
-std::random_device rd_3;
-std::mt19937 mt_3(rd_3());
-std::uniform_real_distribution<double> dist_3(27, INT32_MAX);
 
 RSA::RSA(int bits, int hash_a, int hash_b) {
 	this->bits = bits;
@@ -13,20 +8,16 @@ RSA::RSA(int bits, int hash_a, int hash_b) {
 }
 
 BigInt RSA::get_n(BigInt p, BigInt q) {
-	// maybe dont work
-	auto p_t = p - 1;
-	auto q_t = q - 1;
-
-	this->q_p_mod_p = q.pow(&p_t, p);
-	this->p_q_mod_q = p.pow(&q_t, q);
 	this->p = p;
 	this->q = q;
 	return karatsuba(p, q);
 }
 
 BigInt RSA::carmichael(BigInt p, BigInt q) {
-	BigInt x, y;
-	return ((p - 1) * (q - 1)) / gcd_extended(p - 1, q - 1, &x, &y);
+	Factorization f;
+	f.n = p * q;
+	f.primes = { { min(p, q), 1 }, { max(p, q), 1 } };
+	return ::carmichael(f);
 }
 
 // todo improve later
@@ -41,7 +32,6 @@ int RSA::get_exponent(BigInt phi_n) {
 }
 
 pair<PrivateKey, PublicKey> RSA::generate_keys() {
-	srand(time(0));
 	auto p = rand_prime_fixed_bits(this->bits);
 	auto q = rand_prime_fixed_bits(this->bits);
 	cout << "WE ARE DONE GENERATING NUMBERS" << endl;
@@ -51,9 +41,9 @@ pair<PrivateKey, PublicKey> RSA::generate_keys() {
 	auto phi_n = carmichael(p, q);
 	auto e = get_exponent(phi_n);
 	auto d = reverse_modulo(e, phi_n);
+	this->d = d;
 
-	this->d_mod_p = d % (p - 1);
-	this->d_mod_q = d % (q - 1);
+	this->crt = make_shared<RsaCrtContext>(p, q, d);
 
 	auto keys = pair<PrivateKey, PublicKey>();
 	keys.first = PrivateKey{ d,n };
@@ -62,12 +52,12 @@ pair<PrivateKey, PublicKey> RSA::generate_keys() {
 	return keys;
 }
 
+// one OAEP-padded block per (bits(n) - 1) / 8 - padding bytes of the message
 vector<BigInt> RSA::cypher(string message, BigInt e, const BigInt& n) {
+	MontgomeryContext ctx(n);
 	auto ciphered = vector<BigInt>();
-	for (int i = 0; i < message.size(); i++) {
-		cout << "message[i]: " << int(message[i]) << endl;
-		BigInt tmp = message[i];
-		ciphered.push_back(tmp.pow(&e, n));
+	for (auto block : oaepEncodeBlocks(message, n)) {
+		ciphered.push_back(ctx.powMod(block, e));
 	}
 	return ciphered;
 }
@@ -77,36 +67,24 @@ BigInt cypher_int(BigInt i, BigInt e, const BigInt& n) {
 }
 
 string RSA::decypher(vector<BigInt> c_vec) {
-	string res;
-	for (auto c : c_vec) {
-		auto m = (c.pow(&d_mod_p, p) * q_p_mod_p + c.pow(&d_mod_q, q) * p_q_mod_q) % n;
-		cout << "stuff: " << m.getDigits()[0] << endl;
-		res += char(m.getDigits()[0] / 2);
-	}
-	
-	return res;
+	return vec_to_str(decypher_to_vec(c_vec));
 }
 
 vector<BigInt> RSA::decypher_to_vec(vector<BigInt> c_vec) {
 	vector<BigInt> res;
 	for (auto c : c_vec) {
-		res.push_back((c.pow(&d_mod_p, p) * q_p_mod_p + c.pow(&d_mod_q, q) * p_q_mod_q) % n);
+		res.push_back(decypher_int(c));
 	}
 
 	return res;
 }
 
 string RSA::vec_to_str(vector<BigInt> dec) {
-	string res;
-	for (auto c : dec) {
-		res += char(c.getDigits()[0] / 2);
-	}
-
-	return res;
+	return oaepDecodeBlocks(dec, n);
 }
 
 BigInt RSA::decypher_int(BigInt c) {
-	return (c.pow(&d_mod_p, p) * q_p_mod_p + c.pow(&d_mod_q, q) * p_q_mod_q) % n;
+	return crt->decrypt(c);
 }
 
 BigInt polynomial_hash(std::string str, int m, const BigInt& n) {
@@ -143,6 +121,9 @@ BigInt RSA::convert_to_int(string s) {
 }
 
 BigInt RSA::sign(BigInt c, BigInt d) {
+	if (crt && d == this->d) {
+		return decypher_int(c);
+	}
 	return c.pow(&d, this->n);
 }
 
@@ -194,8 +175,8 @@ void Alice(int hash_a, int hash_b, int bits) {
 }
 
 int main() {
-	auto hash_a = dist_3(mt_3);
-	auto hash_b = dist_3(mt_3);
+	auto hash_a = 27 + threadRandomEngine().uniformBelow((long long)INT32_MAX - 27);
+	auto hash_b = 27 + threadRandomEngine().uniformBelow((long long)INT32_MAX - 27);
 	// auto rsa = RSA(128, hash_a, hash_b);
 
 	auto t1 = chrono::high_resolution_clock::now();
@@ -15,10 +15,9 @@ class RSA {
 private:
 	int bits;
 	BigInt p, q, n;
-	BigInt q_p_mod_p;
-	BigInt p_q_mod_q;
-	BigInt d_mod_p;
-	BigInt d_mod_q;
+	BigInt d;
+	// the private operation by CRT over p and q
+	shared_ptr<RsaCrtContext> crt;
 	int hash_a, hash_b;
 	BigInt get_p();
 	BigInt get_q();
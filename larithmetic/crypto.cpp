@@ -2,8 +2,16 @@
 #include <cstdlib>
 #include <vector>
 #include <map>
+#include <set>
+#include <list>
 #include <chrono>
 #include <random>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <climits>
 
 #include "crypto.h"
 
@@ -12,14 +20,6 @@ using namespace std;
 const long long BigInt::BASE_LEN = 9;
 const long long BigInt::BASE = 1000000000;
 
-std::random_device rd;
-std::mt19937 mt(rd());
-std::uniform_real_distribution<double> dist(0, BigInt::BASE);
-
-std::random_device rd_2;
-std::mt19937 mt_2(rd_2());
-std::uniform_real_distribution<double> dist_2(0, INT_MAX);
-
 BigInt::BigInt() {
 	isNegative = false;
 	digits.clear();
@@ -224,6 +224,142 @@ vector<long long> BigInt::getDigits() {
 	return digits;
 }
 
+// mathematical remainder of |this| by a small positive m (m < 2^33)
+long long BigInt::modSmall(long long m) const {
+	long long rem = 0;
+	for (long long i = (long long)digits.size() - 1; i >= 0; i--) {
+		rem = (rem * BASE + digits[i]) % m;
+	}
+	if (isNegative && rem != 0) {
+		rem = m - rem;
+	}
+	return rem;
+}
+
+// this / m truncated towards zero, m < 2^33
+BigInt BigInt::divSmall(long long m) const {
+	vector<long long> res(digits.size());
+	long long rem = 0;
+	for (long long i = (long long)digits.size() - 1; i >= 0; i--) {
+		long long v = rem * BASE + digits[i];
+		res[i] = v / m;
+		rem = v % m;
+	}
+	BigInt quotient(res, isNegative);
+	quotient.clearNumber();
+	return quotient;
+}
+
+long long BigInt::bitLength() const {
+	vector<unsigned int> words = toWords();
+	long long len = 32 * ((long long)words.size() - 1);
+	for (unsigned int top = words.back(); top != 0; top >>= 1) {
+		len++;
+	}
+	return len;
+}
+
+// |this| in base 2^32, lowest word first
+vector<unsigned int> BigInt::toWords() const {
+	vector<long long> cur = digits;
+	vector<unsigned int> words;
+	while (cur.size() > 1 || cur[0] != 0) {
+		long long rem = 0;
+		for (long long i = (long long)cur.size() - 1; i >= 0; i--) {
+			long long v = rem * BASE + cur[i];
+			cur[i] = v >> 32;
+			rem = v & 0xFFFFFFFFLL;
+		}
+		words.push_back((unsigned int)rem);
+		while (cur.size() > 1 && cur.back() == 0) {
+			cur.pop_back();
+		}
+	}
+	if (words.empty()) {
+		words.push_back(0);
+	}
+	return words;
+}
+
+BigInt BigInt::fromWords(const vector<unsigned int>& words) {
+	vector<long long> res(1, 0);
+	for (long long i = (long long)words.size() - 1; i >= 0; i--) {
+		long long carry = words[i];
+		for (long long j = 0; j < (long long)res.size(); j++) {
+			long long v = res[j] * 4294967296LL + carry;
+			res[j] = v % BASE;
+			carry = v / BASE;
+		}
+		while (carry != 0) {
+			res.push_back(carry % BASE);
+			carry /= BASE;
+		}
+	}
+	return BigInt(res, false);
+}
+
+static long long inverseModSmall(long long a, long long m) {
+	long long r0 = m, r1 = a % m, s0 = 0, s1 = 1;
+	while (r1 != 0) {
+		long long q = r0 / r1;
+		long long r2 = r0 - q * r1;
+		long long s2 = s0 - q * s1;
+		r0 = r1; r1 = r2;
+		s0 = s1; s1 = s2;
+	}
+	return (s0 % m + m) % m;
+}
+
+static long long powModSmall(long long a, long long e, long long m) {
+	long long res = 1 % m;
+	a %= m;
+	while (e > 0) {
+		if (e & 1) {
+			res = res * a % m;
+		}
+		a = a * a % m;
+		e >>= 1;
+	}
+	return res;
+}
+
+// Tonelli-Shanks for a prime p < 2^31 and a quadratic residue a
+static long long sqrtModSmall(long long a, long long p) {
+	a %= p;
+	if (p == 2 || a == 0) {
+		return a;
+	}
+	long long q = p - 1;
+	int s = 0;
+	while (q % 2 == 0) {
+		q /= 2;
+		s++;
+	}
+	long long z = 2;
+	while (powModSmall(z, (p - 1) / 2, p) != p - 1) {
+		z++;
+	}
+	long long c = powModSmall(z, q, p);
+	long long r = powModSmall(a, (q + 1) / 2, p);
+	long long t = powModSmall(a, q, p);
+	int m = s;
+	while (t != 1) {
+		int i = 0;
+		for (long long t2 = t; t2 != 1; t2 = t2 * t2 % p) {
+			i++;
+		}
+		long long b = c;
+		for (int j = 0; j < m - i - 1; j++) {
+			b = b * b % p;
+		}
+		r = r * b % p;
+		c = b * b % p;
+		t = t * c % p;
+		m = i;
+	}
+	return r;
+}
+
 
 
 
@@ -494,29 +630,167 @@ BigInt operator * (long long int1, BigInt bigInt2) {
 	return BigInt(int1) * bigInt2;
 }
 
+static const long long KARATSUBA_THRESHOLD = 32;
+static const long long NTT_THRESHOLD = 256;
+// 998244353 = 119 * 2^23 + 1 has the shortest power-of-two order of the three primes
+static const long long NTT_MAX_LENGTH = 1 << 23;
+
+/*
+ * number-theoretic transform multiplication
+ */
+// in-place transform modulo MOD = c * 2^k + 1 with primitive root 3, the length a power of two up to 2^k
+template <unsigned int MOD>
+static void ntt(vector<unsigned int>& a, bool invert) {
+	long long n = a.size();
+	for (long long i = 1, j = 0; i < n; i++) {
+		long long bit = n >> 1;
+		for (; j & bit; bit >>= 1) {
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j) {
+			swap(a[i], a[j]);
+		}
+	}
+	// powers of a primitive n-th root; the level of length len steps through them n / len apart
+	vector<unsigned int> roots(max(n / 2, 1LL));
+	long long root = powModSmall(3, (MOD - 1) / n, MOD);
+	if (invert) {
+		root = powModSmall(root, MOD - 2, MOD);
+	}
+	roots[0] = 1;
+	for (long long i = 1; i < n / 2; i++) {
+		roots[i] = (unsigned int)((unsigned long long)roots[i - 1] * root % MOD);
+	}
+	for (long long len = 2; len <= n; len <<= 1) {
+		long long stride = n / len;
+		for (long long i = 0; i < n; i += len) {
+			for (long long j = 0; j < len / 2; j++) {
+				unsigned int u = a[i + j];
+				unsigned int v = (unsigned int)((unsigned long long)a[i + j + len / 2] * roots[j * stride] % MOD);
+				a[i + j] = u + v < MOD ? u + v : u + v - MOD;
+				a[i + j + len / 2] = u >= v ? u - v : u + MOD - v;
+			}
+		}
+	}
+	if (invert) {
+		unsigned long long nInverse = powModSmall(n % MOD, MOD - 2, MOD);
+		for (auto& x : a) {
+			x = (unsigned int)(x * nInverse % MOD);
+		}
+	}
+}
+
+// the cyclic convolution of x and y modulo MOD, zero-padded to size; a square transforms once
+template <unsigned int MOD>
+static vector<unsigned int> nttConvolution(const vector<long long>& x, const vector<long long>& y, long long size) {
+	vector<unsigned int> a(size, 0);
+	for (long long i = 0; i < (long long)x.size(); i++) {
+		a[i] = (unsigned int)(x[i] % MOD);
+	}
+	ntt<MOD>(a, false);
+	vector<unsigned int> b;
+	if (&x == &y) {
+		b = a;
+	}
+	else {
+		b.assign(size, 0);
+		for (long long i = 0; i < (long long)y.size(); i++) {
+			b[i] = (unsigned int)(y[i] % MOD);
+		}
+		ntt<MOD>(b, false);
+	}
+	for (long long i = 0; i < size; i++) {
+		a[i] = (unsigned int)((unsigned long long)a[i] * b[i] % MOD);
+	}
+	ntt<MOD>(a, true);
+	return a;
+}
+
+// limb products over three primes whose product (~2^86) bounds every coefficient (below BASE^2 * 2^22), then
+// Garner per coefficient straight into base-10^9 limbs
+static vector<long long> nttMultiply(const vector<long long>& x, const vector<long long>& y) {
+	const unsigned int m1 = 998244353, m2 = 167772161, m3 = 469762049;
+	long long size = 1;
+	while (size < (long long)(x.size() + y.size())) {
+		size <<= 1;
+	}
+	vector<unsigned int> r1 = nttConvolution<m1>(x, y, size);
+	vector<unsigned int> r2 = nttConvolution<m2>(x, y, size);
+	vector<unsigned int> r3 = nttConvolution<m3>(x, y, size);
+
+	const unsigned long long m1InvMod2 = powModSmall(m1 % m2, m2 - 2, m2);
+	const unsigned long long m1InvMod3 = powModSmall(m1 % m3, m3 - 2, m3);
+	const unsigned long long m2InvMod3 = powModSmall(m2 % m3, m3 - 2, m3);
+	const unsigned long long m12 = (unsigned long long)m1 * m2;
+	const unsigned long long m12Low = m12 % BigInt::BASE, m12High = m12 / BigInt::BASE;
+
+	vector<long long> res(x.size() + y.size() + 1, 0);
+	unsigned long long carry = 0;
+	for (long long i = 0; i < (long long)res.size(); i++) {
+		unsigned long long low = carry, high = 0;
+		if (i < size) {
+			// x = a1 + a2 m1 + a3 m1 m2, at most 10^27, as its two lowest base-10^9 positions
+			unsigned long long a1 = r1[i];
+			unsigned long long a2 = (r2[i] + m2 - a1 % m2) % m2 * m1InvMod2 % m2;
+			unsigned long long a3 = ((r3[i] + m3 - a1 % m3) % m3 * m1InvMod3 % m3 + m3 - a2 % m3) % m3 * m2InvMod3 % m3;
+			low += a1 + a2 * m1 + a3 * m12Low;
+			high = a3 * m12High;
+		}
+		res[i] = (long long)(low % BigInt::BASE);
+		carry = low / BigInt::BASE + high;
+	}
+	return res;
+}
+
+// |x| and |y| are split at half the longer length, the three products are recombined by shifting limbs;
+// from NTT_THRESHOLD limbs on both sides the product goes through the transform instead
 BigInt karatsuba(const BigInt& x, const BigInt& y) {
 	long long xLength = x.getLength();
 	long long yLength = y.getLength();
-
-	long long N = (long long)(fmax(xLength, yLength));
-	if (N < 10)
+	if (min(xLength, yLength) < KARATSUBA_THRESHOLD) {
 		return x * y;
+	}
+	if (min(xLength, yLength) >= NTT_THRESHOLD && xLength + yLength <= NTT_MAX_LENGTH) {
+		BigInt res(nttMultiply(x.digits, y.digits), x.isNegative ^ y.isNegative);
+		res.clearNumber();
+		return res;
+	}
 
-	N = (N / 2) + (N % 2);
-		
-	auto thousand = BigInt(BigInt::BASE);
-	BigInt multiplier = thousand.pow(N);
-	BigInt b = BigInt(vector<long long>(x.digits.begin() + N, x.digits.end()), x.isNegative);
-	BigInt a = BigInt(vector<long long>(x.digits.begin(), x.digits.begin() + N), x.isNegative); 
-	BigInt d = BigInt(vector<long long>(y.digits.begin() + N, y.digits.end()), y.isNegative);
-	BigInt c = BigInt(vector<long long>(y.digits.begin(), y.digits.begin() + N), y.isNegative);
+	long long half = (max(xLength, yLength) + 1) / 2;
+	auto low = [half](const vector<long long>& digits) {
+		return BigInt(vector<long long>(digits.begin(), digits.begin() + min(half, (long long)digits.size())), false);
+	};
+	auto high = [half](const vector<long long>& digits) {
+		if ((long long)digits.size() <= half) {
+			return BigInt(0);
+		}
+		return BigInt(vector<long long>(digits.begin() + half, digits.end()), false);
+	};
+	BigInt a = low(x.digits), b = high(x.digits);
+	BigInt c = low(y.digits), d = high(y.digits);
 
 	BigInt z0 = karatsuba(a, c);
-	BigInt z1 = karatsuba(a + b, c + d);
 	BigInt z2 = karatsuba(b, d);
+	BigInt z1 = karatsuba(a + b, c + d) - z0 - z2;
 
+	vector<long long> resDigits(xLength + yLength + 1, 0);
+	auto addShifted = [&resDigits](const BigInt& z, long long shift) {
+		long long carry = 0;
+		long long i = 0;
+		for (; i < (long long)z.digits.size() || carry; i++) {
+			long long v = resDigits[shift + i] + (i < (long long)z.digits.size() ? z.digits[i] : 0) + carry;
+			carry = v >= BigInt::BASE;
+			resDigits[shift + i] = v - (carry ? BigInt::BASE : 0);
+		}
+	};
+	addShifted(z0, 0);
+	addShifted(z1, half);
+	addShifted(z2, 2 * half);
 
-	return z0 + ((z1 - z0 - z2) * multiplier) + (z2 * (BigInt)(thousand.pow(2 * N)));
+	BigInt res(resDigits, x.isNegative ^ y.isNegative);
+	res.clearNumber();
+	return res;
 }
 
 
@@ -680,361 +954,4067 @@ BigInt BigInt::powBySimpleMod(BigInt n, BigInt mod) {
 
 
 
-pair<BigInt, BigInt> solveSimpleSystem(vector< vector<BigInt> > sys) {
-	long long n = sys.size();
-	BigInt c = sys[0][0].reversedBySimpleMod(sys[0][2]) * sys[0][1];
-	c = c.mathMod(sys[0][2]);
-	BigInt d = sys[0][2];
-	for (long long i = 1; i < n; i++) {
-		BigInt c_ = c + d * (sys[i][1] * sys[i][0].reversedBySimpleMod(sys[i][2]) - c) * d.reversedBySimpleMod(sys[i][2]);
-		BigInt d_ = d * sys[i][2];
-		c_ = c_.mathMod(d_);
-		c = c_;
-		d = d_;
+/*
+ * Montgomery
+ */
+static bool wordsLess(const unsigned int* a, const MontgomeryForm& b, int k) {
+	for (int i = k - 1; i >= 0; i--) {
+		if (a[i] != b[i]) {
+			return a[i] < b[i];
+		}
 	}
-	return { c, d };
+	return false;
 }
 
+static void wordsSubInPlace(unsigned int* a, const MontgomeryForm& b, int k) {
+	long long borrow = 0;
+	for (int i = 0; i < k; i++) {
+		long long v = (long long)a[i] - b[i] - borrow;
+		borrow = v < 0;
+		a[i] = (unsigned int)v;
+	}
+}
 
-BigInt gcd(BigInt a, BigInt b) {
-	if (a == 0) {
-		return b;
+MontgomeryContext::MontgomeryContext(BigInt mod_) {
+	if (mod_ <= 1 || mod_.mod2() == 0) {
+		throw "ValueError";
 	}
-	else {
-		return gcd(b % a, a);
+	mod = mod_;
+	m = mod.toWords();
+	k = (int)m.size();
+
+	// m^(-1) mod 2^32 by Newton iteration, every step doubles the correct bits
+	unsigned int inv = m[0];
+	for (int i = 0; i < 4; i++) {
+		inv *= 2 - m[0] * inv;
+	}
+	mInv = 0u - inv;
+
+	r2 = MontgomeryForm(k, 0);
+	r2[0] = 1;
+	for (int i = 0; i < 64 * k; i++) {
+		r2 = add(r2, r2);
 	}
+	MontgomeryForm unit(k, 0);
+	unit[0] = 1;
+	one = mul(r2, unit);
+
+	// BASE^groupLimbs < 2^(32k)
+	groupLimbs = max(1LL, (long long)(32 * k / (BigInt::BASE_LEN * log2(10.0))));
+	MontgomeryForm shift = BigInt(BigInt::BASE).pow(groupLimbs).toWords();
+	shift.resize(k, 0);
+	groupShift = mul(shift, r2);
 }
 
+// a below R goes straight through mul(a, R^2); anything else is folded from the top in groups of
+// groupLimbs base 10^9 limbs (each group below R): acc = acc * BASE^groupLimbs + group, linear in the length of a
+MontgomeryForm MontgomeryContext::toMont(BigInt a) const {
+	if (a >= 0 && a < mod) {
+		MontgomeryForm w = a.toWords();
+		w.resize(k, 0);
+		return mul(w, r2);
+	}
+	vector<long long> limbs = a.getDigits();
+	long long count = limbs.size();
+	MontgomeryForm acc = getZero();
+	for (long long end = count; end > 0; ) {
+		long long begin = end - ((end - 1) % groupLimbs + 1);
+		MontgomeryForm w = BigInt(vector<long long>(limbs.begin() + begin, limbs.begin() + end), false).toWords();
+		w.resize(k, 0);
+		acc = add(mul(acc, groupShift), mul(w, r2));
+		end = begin;
+	}
+	return a < 0 ? sub(getZero(), acc) : acc;
+}
 
-BigInt randBigInt(BigInt p) {
-	long long len = p.getLength();
-	vector<long long> digits(len);
-	for (long long i = 0; i + 1 < len; i++) {
-		digits[i] = (long long)dist(mt) % BigInt::BASE;
+BigInt MontgomeryContext::reduce(BigInt a) const {
+	return fromMont(toMont(a));
+}
+
+BigInt MontgomeryContext::fromMont(const MontgomeryForm& a) const {
+	MontgomeryForm unit(k, 0);
+	unit[0] = 1;
+	return BigInt::fromWords(mul(a, unit));
+}
+
+// CIOS: interleaved multiplication and reduction, a * b * R^(-1) mod m
+MontgomeryForm MontgomeryContext::mul(const MontgomeryForm& a, const MontgomeryForm& b) const {
+	vector<unsigned int> t(k + 2, 0);
+	for (int i = 0; i < k; i++) {
+		unsigned long long carry = 0;
+		unsigned long long bi = b[i];
+		for (int j = 0; j < k; j++) {
+			unsigned long long v = t[j] + a[j] * bi + carry;
+			t[j] = (unsigned int)v;
+			carry = v >> 32;
+		}
+		unsigned long long v = t[k] + carry;
+		t[k] = (unsigned int)v;
+		t[k + 1] = (unsigned int)(v >> 32);
+
+		unsigned long long u = (unsigned int)(t[0] * mInv);
+		carry = (t[0] + u * m[0]) >> 32;
+		for (int j = 1; j < k; j++) {
+			v = t[j] + u * m[j] + carry;
+			t[j - 1] = (unsigned int)v;
+			carry = v >> 32;
+		}
+		v = t[k] + carry;
+		t[k - 1] = (unsigned int)v;
+		t[k] = t[k + 1] + (unsigned int)(v >> 32);
 	}
-	auto pDigits = p.getDigits();
-	digits[len - 1] = (long long)dist(mt) % pDigits[len - 1];
-	return BigInt(digits, false);
+	if (t[k] != 0 || !wordsLess(t.data(), m, k)) {
+		wordsSubInPlace(t.data(), m, k);
+	}
+	t.resize(k);
+	return t;
 }
 
+MontgomeryForm MontgomeryContext::sqr(const MontgomeryForm& a) const {
+	return mul(a, a);
+}
 
-bool testPrimeMillerRabin(BigInt a, long long countRetry = 10) {
-	if (a == 2 || a == 3) {
-		return true;
+MontgomeryForm MontgomeryContext::add(const MontgomeryForm& a, const MontgomeryForm& b) const {
+	MontgomeryForm res(k);
+	unsigned long long carry = 0;
+	for (int i = 0; i < k; i++) {
+		unsigned long long v = (unsigned long long)a[i] + b[i] + carry;
+		res[i] = (unsigned int)v;
+		carry = v >> 32;
 	}
-	if (a == 1 || a % 2 == 0 || a % 3 == 0) {
-		return false;
+	if (carry != 0 || !wordsLess(res.data(), m, k)) {
+		wordsSubInPlace(res.data(), m, k);
 	}
+	return res;
+}
 
-	BigInt q = a - 1;
-	BigInt t = q;
-	int n = 0;
-	while (q % 2 == 0) {
-		q = q / 2;
-		n++;
+MontgomeryForm MontgomeryContext::sub(const MontgomeryForm& a, const MontgomeryForm& b) const {
+	MontgomeryForm res(k);
+	long long borrow = 0;
+	for (int i = 0; i < k; i++) {
+		long long v = (long long)a[i] - b[i] - borrow;
+		borrow = v < 0;
+		res[i] = (unsigned int)v;
 	}
-	for (long long i = 0; i < countRetry; i++) {
-		BigInt k = randBigInt(a - 2) + 2;
-		BigInt b = k.pow(&q, a);
-		if (b == 1 || b == t) {
-			continue;
-		}
-		BigInt j = 0;
-		while (j < n) {
-			auto two = BigInt(2);
-			b = b.pow(&two, a);
-			if (b == t) {
-				break;
-			}
-			j++;
-		}
-		if (j < n) {
-			continue;
-		}
-		else {
-			return false;
+	if (borrow) {
+		unsigned long long carry = 0;
+		for (int i = 0; i < k; i++) {
+			unsigned long long v = (unsigned long long)res[i] + m[i] + carry;
+			res[i] = (unsigned int)v;
+			carry = v >> 32;
 		}
 	}
-	return true;
+	return res;
 }
 
-BigInt rhoPollardDivisor(BigInt n, BigInt iterationsCount) {
-	BigInt x = randBigInt(n);
-	BigInt y = fPollard(x, n);
-	BigInt g = gcd((x - y).abs(), n);
+// fixed 4-bit window over the binary digits of n
+MontgomeryForm MontgomeryContext::pow(const MontgomeryForm& a, const BigInt& n) const {
+	if (n < 0) {
+		throw "ValueError";
+	}
+	vector<unsigned int> bits = n.toWords();
+	vector<MontgomeryForm> table(16);
+	table[0] = one;
+	for (int i = 1; i < 16; i++) {
+		table[i] = mul(table[i - 1], a);
+	}
 
-	for (BigInt i = 0; i < iterationsCount && (g == 1 || g == n); i++) {
-		x = fPollard(x, n);
-		y = fPollard(fPollard(y, n), n);
-		g = gcd((x - y).abs(), n);
+	MontgomeryForm res = one;
+	bool started = false;
+	for (long long i = (long long)bits.size() - 1; i >= 0; i--) {
+		for (int shift = 28; shift >= 0; shift -= 4) {
+			int nibble = (bits[i] >> shift) & 15;
+			if (started) {
+				for (int j = 0; j < 4; j++) {
+					res = sqr(res);
+				}
+				if (nibble != 0) {
+					res = mul(res, table[nibble]);
+				}
+			}
+			else if (nibble != 0) {
+				res = table[nibble];
+				started = true;
+			}
+		}
 	}
-	return g;
+	return res;
 }
 
+BigInt MontgomeryContext::powMod(BigInt a, BigInt n) const {
+	return fromMont(pow(toMont(a), n));
+}
 
-BigInt fPollard(BigInt a, BigInt mod) {
-	return (a * a + 1) % mod;
+MontgomeryForm MontgomeryContext::getOne() const {
+	return one;
 }
 
-BigInt getDivisor(BigInt n, long long countRetry = 10) {
-	if (testPrimeMillerRabin(n)) {
-		return n;
-	}
-	BigInt iterationsCount = (n.sqrt()).sqrt() + 2;
-	BigInt d;
-	for (long long i = 0; i < countRetry; i++) {
-		d = rhoPollardDivisor(n, iterationsCount);
-		if (d > 1 && d < n) {
-			return getDivisor(n / d);
-		}
-	}
-	return n;
+MontgomeryForm MontgomeryContext::getZero() const {
+	return MontgomeryForm(k, 0);
 }
 
+BigInt MontgomeryContext::getMod() const {
+	return mod;
+}
 
-vector<pair<BigInt, BigInt>> rhoPollardFactorization(BigInt n) {
-	vector <pair<BigInt, BigInt>> factorization;// <d, pw>
+/*
+ * simultaneous exponentiation
+ */
 
-	while (n % 2 == 0) {
-		n = n / 2;
-		if ((long long)factorization.size() == 0) {
-			factorization.push_back({ 2, 1 });
+// left-to-right sliding windows of at most w bits: digits[j] is the odd window value whose lowest bit is j
+static vector<int> slidingWindowDigits(const vector<unsigned int>& words, int w) {
+	long long bits = (long long)words.size() * 32;
+	auto bit = [&](long long i) {
+		return (int)((words[i / 32] >> (i % 32)) & 1);
+	};
+	vector<int> digits(bits, 0);
+	for (long long i = bits - 1; i >= 0;) {
+		if (!bit(i)) {
+			i--;
+			continue;
 		}
-		else {
-			factorization[0].second++;
+		long long j = max(i - w + 1, 0LL);
+		while (!bit(j)) {
+			j++;
+		}
+		int value = 0;
+		for (long long t = i; t >= j; t--) {
+			value = 2 * value + bit(t);
 		}
+		digits[j] = value;
+		i = j - 1;
 	}
+	return digits;
+}
 
-	BigInt d = 1;
-	while (n != 1) {
-		d = getDivisor(n);
-		factorization.push_back({ d, 0 });
-		while (n % d == 0) {
-			n = n / d;
-			factorization.back().second++;
+// Straus: prod b_i^e_i mod m over one chain of squarings, each exponent in odd sliding windows of its own
+// table. Negative exponents invert their base; an even modulus falls back to separate powers
+BigInt multiPowMod(const vector<BigInt>& bases, const vector<BigInt>& exponents, BigInt mod) {
+	if (bases.size() != exponents.size() || mod < 1) {
+		throw "ValueError";
+	}
+	if (mod == 1) {
+		return 0;
+	}
+	vector<BigInt> b(bases.size()), e(exponents.size());
+	long long bits = 0;
+	for (size_t i = 0; i < bases.size(); i++) {
+		b[i] = bases[i];
+		b[i] = b[i].mathMod(mod);
+		e[i] = exponents[i];
+		if (e[i] < 0) {
+			b[i] = reverse_modulo(b[i], mod);
+			if (b[i] < 0) {
+				throw "ValueError";
+			}
+			e[i] = -e[i];
 		}
+		bits = max(bits, e[i].bitLength());
 	}
-
-	if (n > 1 || (long long)factorization.size() == 0) {
-		factorization.push_back({ n, 1 });
+	if (mod.mod2() == 0) {
+		BigInt res = 1;
+		for (size_t i = 0; i < b.size(); i++) {
+			res = res * b[i].powBySimpleMod(e[i], mod) % mod;
+		}
+		return res;
 	}
 
-	return factorization;
-}
-
-
-BigInt babyStepGiantStepLog(BigInt a, BigInt b, BigInt p) {
-	BigInt m = p.sqrt() + 1;
-	BigInt am = a.powBySimpleMod(m, p);
-
-	map<BigInt, BigInt> mp;
-	for (BigInt i = 1, tmp = am; i <= m; i++) {
-		cout << i << " "  << m << endl;
-		if (!mp.count(tmp)) {
-			mp[tmp] = i;
+	MontgomeryContext ctx(mod);
+	int w = bits <= 64 ? 3 : bits <= 256 ? 4 : bits <= 1024 ? 5 : 6;
+	vector<vector<MontgomeryForm>> tables;
+	vector<vector<int>> digits;
+	for (size_t i = 0; i < b.size(); i++) {
+		if (e[i] == 0) {
+			continue;
+		}
+		// b, b^3, ..., b^(2^w - 1)
+		vector<MontgomeryForm> table(1 << (w - 1));
+		table[0] = ctx.toMont(b[i]);
+		MontgomeryForm square = ctx.sqr(table[0]);
+		for (size_t j = 1; j < table.size(); j++) {
+			table[j] = ctx.mul(table[j - 1], square);
 		}
-		tmp = tmp.mulBySimpleMod(am, p);
+		tables.push_back(table);
+		digits.push_back(slidingWindowDigits(e[i].toWords(), w));
 	}
 
-	for (BigInt i = 0, tmp = b; i <= m; i++) {
-		cout << i << " " << m << endl;
-		if (mp.count(tmp)) {
-			BigInt ans = mp[tmp] * m - i;
-			if (ans < p) {
-				return ans;
+	MontgomeryForm acc = ctx.getOne();
+	bool started = false;
+	for (long long pos = bits - 1; pos >= 0; pos--) {
+		if (started) {
+			acc = ctx.sqr(acc);
+		}
+		for (size_t t = 0; t < tables.size(); t++) {
+			int d = pos < (long long)digits[t].size() ? digits[t][pos] : 0;
+			if (d != 0) {
+				acc = started ? ctx.mul(acc, tables[t][d / 2]) : tables[t][d / 2];
+				started = true;
 			}
 		}
-		tmp = tmp.mulBySimpleMod(a, p);
 	}
+	return ctx.fromMont(acc);
+}
 
-	return -1;
+
+
+/*
+ * product and remainder trees
+ */
+
+// x * BASE^n, or x / BASE^(-n) truncated for negative n
+static BigInt shiftLimbs(BigInt x, long long n) {
+	bool negative = x < 0;
+	vector<long long> digits = x.getDigits();
+	if (n >= 0) {
+		digits.insert(digits.begin(), n, 0);
+	}
+	else if (-n >= (long long)digits.size()) {
+		return 0;
+	}
+	else {
+		digits.erase(digits.begin(), digits.begin() - n);
+	}
+	return BigInt(digits, negative);
 }
 
+// floor(BASE^L / m): a half-length reciprocal of the top limbs of m, one Newton step
+// x <- x + x (BASE^L - m x) / BASE^L at full length and a final correction by a few units
+static BigInt limbReciprocal(BigInt m, long long L) {
+	vector<long long> digits = m.getDigits();
+	long long n = digits.size();
+	long long k = L - n + 1;
+	BigInt x;
+	if (k <= 2) {
+		long long t = min(n, 3LL);
+		long double top = 0;
+		for (long long i = n - 1; i >= n - t; i--) {
+			top = top * BigInt::BASE + digits[i];
+		}
+		// m ~ top * BASE^(n - t), BASE^t / top lies in (1, BASE]
+		long double v = powl((long double)BigInt::BASE, (long double)t) / top;
+		x = shiftLimbs(BigInt((long long)(v * BigInt::BASE)), L - n - 1);
+	}
+	else {
+		long long h = k / 2 + 1;
+		long long s = max(0LL, n - h - 1);
+		long long halfL = h + (n - s) - 1;
+		x = shiftLimbs(limbReciprocal(shiftLimbs(m, -s), halfL), L - s - halfL);
+	}
 
-BigInt euler(BigInt n) {
-	if (n == 1) {
-		return 1;
+	BigInt power = shiftLimbs(1, L);
+	BigInt e = power - karatsuba(m, x);
+	for (int i = 0; i < 4 && (e < 0 || e >= m); i++) {
+		x = x + shiftLimbs(karatsuba(x, e), -L);
+		e = power - karatsuba(m, x);
 	}
-	auto factorization = rhoPollardFactorization(n);
-	BigInt ans = 1;
-	for (auto el : factorization) {
-		ans = ans * el.first.pow(el.second - 1) * (el.first - 1);
+	while (e < 0) {
+		x = x - 1;
+		e = e + m;
 	}
-	return ans;
+	while (e >= m) {
+		x = x + 1;
+		e = e - m;
+	}
+	return x;
 }
 
+// Barrett division by m for 0 <= x < BASE^L: the quotient estimate from the top limbs is short by at most 3
+struct BarrettReducer {
+	BigInt m;
+	long long n;
+	long long L;
+	BigInt mu;
 
-BigInt mobius(BigInt n) {
-	if (n == 1) {
-		return 1;
+	BarrettReducer(BigInt m_, long long L_) : m(m_), n(m_.getLength()), L(max(L_, m_.getLength())) {
+		mu = limbReciprocal(m, L);
 	}
-	auto factorization = rhoPollardFactorization(n);
-	for (auto el : factorization) {
-		if (el.second > 1) {
-			return 0;
+
+	pair<BigInt, BigInt> divMod(const BigInt& x) const {
+		BigInt q = shiftLimbs(karatsuba(shiftLimbs(x, -(n - 1)), mu), -(L - n + 1));
+		BigInt r = x - karatsuba(q, m);
+		while (r >= m) {
+			r = r - m;
+			q = q + 1;
+		}
+		return { q, r };
+	}
+};
+
+// levels of the product tree, leaves first and the product of all of them last
+static vector<vector<BigInt>> productTree(const vector<BigInt>& leaves, ThreadPool& pool) {
+	vector<vector<BigInt>> tree;
+	tree.push_back(leaves);
+	while (tree.back().size() > 1) {
+		const vector<BigInt>& level = tree.back();
+		vector<BigInt> next((level.size() + 1) / 2);
+		for (long long j = 0; j < (long long)next.size(); j++) {
+			pool.submit([&level, &next, j] {
+				next[j] = 2 * j + 1 < (long long)level.size() ? karatsuba(level[2 * j], level[2 * j + 1]) : level[2 * j];
+			});
 		}
+		pool.wait();
+		tree.push_back(next);
 	}
-	return (long long)factorization.size() % 2 == 0 ? 1 : -1;
+	return tree;
 }
 
-
-BigInt legendre(BigInt a, BigInt p) {
-	BigInt ans = a.powBySimpleMod((p - 1) / 2, p);
-	if (ans > 1) {
-		ans = ans - p;
+// x mod leaf^2 for every leaf of the tree, reduced level by level from x mod root^2
+static vector<BigInt> remainderTree(const vector<vector<BigInt>>& tree, const BigInt& x, ThreadPool& pool) {
+	BigInt rootSquare = karatsuba(tree.back()[0], tree.back()[0]);
+	vector<BigInt> remainders = { x < rootSquare ? x : BarrettReducer(rootSquare, x.getLength()).divMod(x).second };
+	for (long long l = (long long)tree.size() - 2; l >= 0; l--) {
+		const vector<BigInt>& level = tree[l];
+		vector<BigInt> next(level.size());
+		for (long long i = 0; i < (long long)level.size(); i++) {
+			pool.submit([&level, &next, &remainders, i] {
+				BigInt square = karatsuba(level[i], level[i]);
+				const BigInt& parent = remainders[i / 2];
+				next[i] = parent < square ? parent : BarrettReducer(square, parent.getLength()).divMod(parent).second;
+			});
+		}
+		pool.wait();
+		remainders = next;
 	}
-	return ans;
+	return remainders;
 }
 
 
-BigInt jacobi(BigInt n, BigInt m) {
-	if (gcd(n,m) != 1) {
-		return 0;
-	}
 
-	int r = 1;
-	BigInt c;
+/*
+ * Chinese remainder theorem
+ */
+static const long long CRT_TREE_THRESHOLD = 16;
 
-	if (n < 0) {
-		n = -n;
-		if (m.mathMod(4) == 3) {
-			r = -r;
+CrtContext::CrtContext(const vector<BigInt>& moduli_) : moduli(moduli_) {
+	long long count = moduli.size();
+	if (count == 0) {
+		throw "ValueError";
+	}
+	for (auto& m : moduli) {
+		if (m < 1) {
+			throw "ValueError";
 		}
+		reducers.push_back(m.mod2() == 1 && m > 1 ? make_shared<MontgomeryContext>(m) : nullptr);
 	}
 
-	while (n != 0) {
-		int t = 0;
-
-		while (n % 2 == 0) {
-			t++;
-			n = n / 2;
+	// product tree, level 0 are the moduli
+	tree.push_back(moduli);
+	while (tree.back().size() > 1) {
+		const vector<BigInt>& level = tree.back();
+		vector<BigInt> next;
+		for (long long i = 0; i < (long long)level.size(); i += 2) {
+			next.push_back(i + 1 < (long long)level.size() ? karatsuba(level[i], level[i + 1]) : level[i]);
 		}
-
-		if (t % 2) {
-			if (m.mathMod(8) == 3 || m.mathMod(8) == 5) {
-				r = -r;
+		tree.push_back(next);
+	}
+	product = tree.back()[0];
+
+	if (count < CRT_TREE_THRESHOLD) {
+		// Garner: x = v_0 + v_1 m_0 + v_2 m_0 m_1 + ..., constants (m_0 ... m_(i-1))^(-1) mod m_i
+		BigInt prefix = 1;
+		for (long long i = 0; i < count; i++) {
+			BigInt inverse = i == 0 ? BigInt(1) : reverse_modulo(reduce(prefix, i), moduli[i]);
+			if (inverse == -1) {
+				throw "ValueError";
 			}
+			prefixProducts.push_back(prefix);
+			constants.push_back(inverse);
+			prefix = prefix * moduli[i];
 		}
+		return;
+	}
 
-		if (n.mathMod(4) == 3 && m.mathMod(4) == 3) {
-			r = -r;
+	// (M / m_i)^(-1) mod m_i: M mod m_i^2 = m_i (M / m_i mod m_i) comes down the product tree as in batchGcd
+	ThreadPool pool(defaultThreadCount());
+	vector<BigInt> remainders = remainderTree(tree, product, pool);
+	// the combined sum stays below count * M, one limb past M
+	productReducer = make_shared<BarrettReducer>(product, product.getLength() + 1);
+	for (long long i = 0; i < count; i++) {
+		BigInt inverse = 0;
+		if (moduli[i] > 1) {
+			BigInt cofactor = BarrettReducer(moduli[i], remainders[i].getLength()).divMod(remainders[i]).first;
+			inverse = reverse_modulo(cofactor, moduli[i]);
+		}
+		if (inverse == -1) {
+			throw "ValueError";
 		}
-		c = n;
-		n = m.mathMod(c);
-		m = c;
+		constants.push_back(inverse);
 	}
-	return r;
-
 }
 
+BigInt CrtContext::reduce(const BigInt& x, long long i) const {
+	return reducers[i] ? reducers[i]->reduce(x) : BigInt(x).mathMod(moduli[i]);
+}
+
+// the x mod M with x = residues[i] mod moduli[i]
+BigInt CrtContext::reconstruct(const vector<BigInt>& residues) const {
+	long long count = moduli.size();
+	if ((long long)residues.size() != count) {
+		throw "ValueError";
+	}
+
+	if (count < CRT_TREE_THRESHOLD) {
+		BigInt x = reduce(residues[0], 0);
+		for (long long i = 1; i < count; i++) {
+			BigInt v = reduce((residues[i] - reduce(x, i)) * constants[i], i);
+			x = x + v * prefixProducts[i];
+		}
+		return x;
+	}
+
+	// sum of (r_i c_i mod m_i) * M / m_i, combined up the tree as l * prod(right) + r * prod(left)
+	vector<BigInt> level(count);
+	for (long long i = 0; i < count; i++) {
+		level[i] = reduce(reduce(residues[i], i) * constants[i], i);
+	}
+	for (long long l = 0; l + 1 < (long long)tree.size(); l++) {
+		vector<BigInt> next;
+		for (long long i = 0; i < (long long)level.size(); i += 2) {
+			if (i + 1 < (long long)level.size()) {
+				next.push_back(karatsuba(level[i], tree[l][i + 1]) + karatsuba(level[i + 1], tree[l][i]));
+			}
+			else {
+				next.push_back(level[i]);
+			}
+		}
+		level = next;
+	}
+	return productReducer->divMod(level[0]).second;
+}
+
+vector<BigInt> CrtContext::reconstruct(const vector<vector<BigInt>>& residues, int threads) const {
+	vector<BigInt> result(residues.size());
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	for (long long i = 0; i < (long long)residues.size(); i++) {
+		pool.submit([this, &residues, &result, i] { result[i] = reconstruct(residues[i]); });
+	}
+	pool.wait();
+	return result;
+}
+
+BigInt CrtContext::getProduct() const {
+	return product;
+}
+
+const vector<BigInt>& CrtContext::getModuli() const {
+	return moduli;
+}
+
+RsaCrtContext::RsaCrtContext(BigInt p, BigInt q, const BigInt& d) {
+	if (p.mod2() == 0 || q.mod2() == 0 || p == q) {
+		throw "ValueError";
+	}
+	dP = d % (p - 1);
+	dQ = d % (q - 1);
+	montP = make_shared<MontgomeryContext>(p);
+	montQ = make_shared<MontgomeryContext>(q);
+	// Garner over {q, p}: m = m_q + q * (q^(-1) (m_p - m_q) mod p), with no reduction mod pq
+	crt = make_shared<CrtContext>(vector<BigInt>{ q, p });
+}
+
+BigInt RsaCrtContext::decrypt(const BigInt& c) const {
+	BigInt mP;
+	thread halfP([&] {
+		mP = montP->powMod(c, dP);
+	});
+	BigInt mQ = montQ->powMod(c, dQ);
+	halfP.join();
+	return crt->reconstruct(vector<BigInt>{ mQ, mP });
+}
+
+// rows {a, b, m} of a * x = b mod m, pairwise coprime m; returns {x, product of m}
+pair<BigInt, BigInt> solveSimpleSystem(vector< vector<BigInt> > sys) {
+	vector<BigInt> moduli, residues;
+	for (auto& row : sys) {
+		moduli.push_back(row[2]);
+		BigInt inverse = reverse_modulo(row[0].mathMod(row[2]), row[2]);
+		if (inverse == -1) {
+			throw "ValueError";
+		}
+		residues.push_back(row[1] * inverse);
+	}
+	CrtContext ctx(moduli);
+	return { ctx.reconstruct(residues), ctx.getProduct() };
+}
+
+
+BigInt gcd(BigInt a, BigInt b) {
+	if (a == 0) {
+		return b;
+	}
+	else {
+		return gcd(b % a, a);
+	}
+}
+
+static bool isZeroWords(const vector<unsigned int>& a) {
+	return a.size() == 1 && a[0] == 0;
+}
+
+static void trimWords(vector<unsigned int>& a) {
+	while (a.size() > 1 && a.back() == 0) {
+		a.pop_back();
+	}
+}
+
+static int compareWords(const vector<unsigned int>& a, const vector<unsigned int>& b) {
+	if (a.size() != b.size()) {
+		return a.size() < b.size() ? -1 : 1;
+	}
+	for (long long i = (long long)a.size() - 1; i >= 0; i--) {
+		if (a[i] != b[i]) {
+			return a[i] < b[i] ? -1 : 1;
+		}
+	}
+	return 0;
+}
+
+// a -= b for a >= b
+static void subWords(vector<unsigned int>& a, const vector<unsigned int>& b) {
+	long long borrow = 0;
+	for (long long i = 0; i < (long long)a.size(); i++) {
+		long long v = (long long)a[i] - (i < (long long)b.size() ? b[i] : 0) - borrow;
+		borrow = v < 0;
+		a[i] = (unsigned int)v;
+	}
+	trimWords(a);
+}
+
+static long long trailingZeroBits(const vector<unsigned int>& a) {
+	long long res = 0;
+	long long i = 0;
+	while (i < (long long)a.size() && a[i] == 0) {
+		res += 32;
+		i++;
+	}
+	if (i < (long long)a.size()) {
+		for (unsigned int w = a[i]; (w & 1) == 0; w >>= 1) {
+			res++;
+		}
+	}
+	return res;
+}
+
+static void shiftRightWords(vector<unsigned int>& a, long long bits) {
+	long long wordShift = bits / 32;
+	int bitShift = bits % 32;
+	if (wordShift >= (long long)a.size()) {
+		a.assign(1, 0);
+		return;
+	}
+	a.erase(a.begin(), a.begin() + wordShift);
+	if (bitShift != 0) {
+		for (long long i = 0; i < (long long)a.size(); i++) {
+			unsigned int hi = i + 1 < (long long)a.size() ? a[i + 1] : 0;
+			a[i] = (a[i] >> bitShift) | (hi << (32 - bitShift));
+		}
+	}
+	trimWords(a);
+}
+
+// Stein's algorithm on base 2^32 words, gcd(|a|, |b|)
+static vector<unsigned int> gcdWords(vector<unsigned int> u, vector<unsigned int> v) {
+	trimWords(u);
+	trimWords(v);
+	if (isZeroWords(u)) {
+		return v;
+	}
+	if (isZeroWords(v)) {
+		return u;
+	}
+	long long uZeros = trailingZeroBits(u);
+	long long vZeros = trailingZeroBits(v);
+	long long shift = min(uZeros, vZeros);
+	shiftRightWords(u, uZeros);
+	shiftRightWords(v, vZeros);
+	while (!isZeroWords(v)) {
+		if (compareWords(u, v) > 0) {
+			swap(u, v);
+		}
+		subWords(v, u);
+		if (!isZeroWords(v)) {
+			shiftRightWords(v, trailingZeroBits(v));
+		}
+	}
+
+	if (shift % 32 != 0) {
+		u.push_back(0);
+		for (long long i = (long long)u.size() - 1; i >= 0; i--) {
+			unsigned int lo = i > 0 ? u[i - 1] : 0;
+			u[i] = (u[i] << (shift % 32)) | (lo >> (32 - shift % 32));
+		}
+	}
+	u.insert(u.begin(), shift / 32, 0);
+	trimWords(u);
+	return u;
+}
+
+BigInt binaryGcd(BigInt a, BigInt b) {
+	return BigInt::fromWords(gcdWords(a.toWords(), b.toWords()));
+}
+
+// Jacobi symbol (a / b) for odd b, binary: twos leave a through (2 / b) from b mod 8, odd a < b swap with
+// reciprocity from the low two bits, then a -= b; b ends at gcd(a, b) and a gcd above one gives 0
+static int jacobiWords(vector<unsigned int> a, vector<unsigned int> b) {
+	trimWords(a);
+	trimWords(b);
+	int result = 1;
+	while (!isZeroWords(a)) {
+		long long zeros = trailingZeroBits(a);
+		if (zeros > 0) {
+			shiftRightWords(a, zeros);
+			if ((zeros & 1) && ((b[0] & 7) == 3 || (b[0] & 7) == 5)) {
+				result = -result;
+			}
+		}
+		if (compareWords(a, b) < 0) {
+			swap(a, b);
+			if ((a[0] & 3) == 3 && (b[0] & 3) == 3) {
+				result = -result;
+			}
+		}
+		subWords(a, b);
+	}
+	return b.size() == 1 && b[0] == 1 ? result : 0;
+}
+
+
+/*
+ * batch gcd
+ */
+
+// gcd(n_i, (P mod n_i^2) / n_i) for every modulus, appended to result
+static void batchGcdLeaves(const vector<BigInt>& moduli, const vector<BigInt>& remainders, vector<BigInt>& result,
+	ThreadPool& pool) {
+	size_t offset = result.size();
+	result.resize(offset + moduli.size());
+	for (long long i = 0; i < (long long)moduli.size(); i++) {
+		pool.submit([&moduli, &remainders, &result, offset, i] {
+			BigInt quotient = BarrettReducer(moduli[i], remainders[i].getLength()).divMod(remainders[i]).first;
+			result[offset + i] = binaryGcd(quotient, moduli[i]);
+		});
+	}
+	pool.wait();
+}
+
+// Bernstein: product tree of the moduli, remainder tree of P mod n_i^2 down from the root, then
+// gcd(n_i, (P mod n_i^2) / n_i); every level of both trees is spread over the pool
+vector<BigInt> batchGcd(const vector<BigInt>& moduli, int threads) {
+	vector<BigInt> result;
+	if (moduli.empty()) {
+		return result;
+	}
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	vector<vector<BigInt>> tree = productTree(moduli, pool);
+	batchGcdLeaves(moduli, remainderTree(tree, tree.back()[0], pool), result, pool);
+	return result;
+}
+
+static bool readModuli(istream& input, vector<BigInt>& chunk, size_t chunkSize) {
+	chunk.clear();
+	BigInt n;
+	while (chunk.size() < chunkSize && input >> n) {
+		chunk.push_back(n);
+	}
+	return !chunk.empty();
+}
+
+// whitespace separated decimal moduli, chunkSize at a time. The first pass keeps only the product P_c of every
+// chunk; a remainder tree over those products gives P mod P_c^2, and the second pass rereads each chunk and
+// runs its own remainder tree down from there, as n_i^2 divides P_c^2. Only one chunk's trees are held at a
+// time, next to the chunk products (the size of P). The input is read twice, so it has to be seekable
+vector<BigInt> batchGcd(istream& input, int threads, size_t chunkSize) {
+	streampos start = input.tellg();
+	if (start == streampos(-1) || chunkSize == 0) {
+		throw "ValueError";
+	}
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	vector<BigInt> chunk, chunkProducts;
+	while (readModuli(input, chunk, chunkSize)) {
+		chunkProducts.push_back(productTree(chunk, pool).back()[0]);
+	}
+	vector<BigInt> result;
+	if (chunkProducts.empty()) {
+		return result;
+	}
+	vector<BigInt> chunkRemainders;
+	{
+		vector<vector<BigInt>> tree = productTree(chunkProducts, pool);
+		chunkRemainders = remainderTree(tree, tree.back()[0], pool);
+	}
+
+	input.clear();
+	input.seekg(start);
+	for (size_t c = 0; c < chunkProducts.size() && readModuli(input, chunk, chunkSize); c++) {
+		vector<vector<BigInt>> tree = productTree(chunk, pool);
+		batchGcdLeaves(chunk, remainderTree(tree, chunkRemainders[c], pool), result, pool);
+	}
+	return result;
+}
+
+
+/*
+ * threads
+ */
+ThreadPool::ThreadPool(int threads) {
+	running = 0;
+	stopping = false;
+	for (int i = 0; i < max(1, threads); i++) {
+		workers.push_back(thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock<mutex> guard(lock);
+			taskAvailable.wait(guard, [this] { return stopping || !tasks.empty(); });
+			if (tasks.empty()) {
+				return;
+			}
+			task = move(tasks.front());
+			tasks.pop();
+			running++;
+		}
+		try {
+			task();
+		}
+		catch (...) {
+			unique_lock<mutex> guard(lock);
+			if (!error) {
+				error = current_exception();
+			}
+		}
+		{
+			unique_lock<mutex> guard(lock);
+			running--;
+			if (running == 0 && tasks.empty()) {
+				tasksDone.notify_all();
+			}
+		}
+	}
+}
+
+void ThreadPool::submit(function<void()> task) {
+	{
+		unique_lock<mutex> guard(lock);
+		tasks.push(move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+// blocks until every submitted task has finished, rethrows the first exception of a task
+void ThreadPool::wait() {
+	unique_lock<mutex> guard(lock);
+	tasksDone.wait(guard, [this] { return running == 0 && tasks.empty(); });
+	if (error) {
+		exception_ptr e = error;
+		error = nullptr;
+		rethrow_exception(e);
+	}
+}
+
+int ThreadPool::size() const {
+	return (int)workers.size();
+}
+
+int defaultThreadCount() {
+	return max(1, (int)thread::hardware_concurrency());
+}
+
+
+/*
+ * random
+ */
+static inline unsigned int rotl32(unsigned int x, int n) {
+	return (x << n) | (x >> (32 - n));
+}
+
+static inline void chachaQuarterRound(unsigned int* s, int a, int b, int c, int d) {
+	s[a] += s[b]; s[d] ^= s[a]; s[d] = rotl32(s[d], 16);
+	s[c] += s[d]; s[b] ^= s[c]; s[b] = rotl32(s[b], 12);
+	s[a] += s[b]; s[d] ^= s[a]; s[d] = rotl32(s[d], 8);
+	s[c] += s[d]; s[b] ^= s[c]; s[b] = rotl32(s[b], 7);
+}
+
+RandomEngine::RandomEngine() {
+	std::random_device rd;
+	for (int i = 0; i < 8; i++) {
+		key[i] = rd();
+	}
+	for (int i = 0; i < 3; i++) {
+		nonce[i] = rd();
+	}
+	counter = 0;
+	position = BUFFER_WORDS;
+	powerBits = -1;
+}
+
+RandomEngine::RandomEngine(const vector<unsigned int>& key_, const vector<unsigned int>& nonce_, unsigned int counter_) {
+	for (int i = 0; i < 8; i++) {
+		key[i] = i < (int)key_.size() ? key_[i] : 0;
+	}
+	for (int i = 0; i < 3; i++) {
+		nonce[i] = i < (int)nonce_.size() ? nonce_[i] : 0;
+	}
+	counter = counter_;
+	position = BUFFER_WORDS;
+	powerBits = -1;
+}
+
+// ChaCha20 block function (RFC 7539), several blocks per refill
+void RandomEngine::refill() {
+	for (int block = 0; block < BLOCKS_PER_REFILL; block++) {
+		unsigned int state[16] = {
+			0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+			key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+			counter, nonce[0], nonce[1], nonce[2]
+		};
+		unsigned int working[16];
+		for (int i = 0; i < 16; i++) {
+			working[i] = state[i];
+		}
+		for (int round = 0; round < 10; round++) {
+			chachaQuarterRound(working, 0, 4, 8, 12);
+			chachaQuarterRound(working, 1, 5, 9, 13);
+			chachaQuarterRound(working, 2, 6, 10, 14);
+			chachaQuarterRound(working, 3, 7, 11, 15);
+			chachaQuarterRound(working, 0, 5, 10, 15);
+			chachaQuarterRound(working, 1, 6, 11, 12);
+			chachaQuarterRound(working, 2, 7, 8, 13);
+			chachaQuarterRound(working, 3, 4, 9, 14);
+		}
+		for (int i = 0; i < 16; i++) {
+			buffer[block * 16 + i] = working[i] + state[i];
+		}
+
+		counter++;
+		if (counter == 0) {
+			nonce[0]++;
+		}
+	}
+	position = 0;
+}
+
+unsigned int RandomEngine::next32() {
+	if (position == BUFFER_WORDS) {
+		refill();
+	}
+	return buffer[position++];
+}
+
+unsigned long long RandomEngine::next64() {
+	unsigned long long lo = next32();
+	unsigned long long hi = next32();
+	return (hi << 32) | lo;
+}
+
+// uniform in [0, BASE): 4 * BASE fits into 32 bits, reject the tail above it
+long long RandomEngine::nextLimb() {
+	const unsigned int limit = 4 * (unsigned int)BigInt::BASE;
+	unsigned int v = next32();
+	while (v >= limit) {
+		v = next32();
+	}
+	return v % BigInt::BASE;
+}
+
+void RandomEngine::fillLimbs(vector<long long>& limbs) {
+	for (long long i = 0; i < (long long)limbs.size(); i++) {
+		limbs[i] = nextLimb();
+	}
+}
+
+long long RandomEngine::uniformBelow(long long bound) {
+	if (bound <= 0) {
+		throw "ValueError";
+	}
+	unsigned long long b = bound;
+	unsigned long long limit = ~0ULL - (~0ULL % b);
+	unsigned long long v = next64();
+	while (v >= limit) {
+		v = next64();
+	}
+	return (long long)(v % b);
+}
+
+// rejection sampling: low limbs are filled in bulk, the top limb is drawn from [0, top],
+// so every attempt succeeds with probability at least 1/2
+BigInt RandomEngine::uniformBelow(BigInt bound) {
+	if (bound <= 0) {
+		throw "ValueError";
+	}
+	long long len = bound.getLength();
+	long long top = bound.getDigits()[len - 1];
+	vector<long long> limbs(len);
+	while (true) {
+		fillLimbs(limbs);
+		limbs[len - 1] = uniformBelow(top + 1);
+		BigInt res(limbs, false);
+		if (res < bound) {
+			return res;
+		}
+	}
+}
+
+// uniform in [2^(n-1), 2^n)
+BigInt RandomEngine::fixedBits(int n) {
+	if (n < 1) {
+		throw "ValueError";
+	}
+	if (n != powerBits) {
+		powerOfTwo = BigInt(2).pow(n - 1);
+		powerBits = n;
+	}
+	return powerOfTwo + uniformBelow(powerOfTwo);
+}
+
+RandomEngine& threadRandomEngine() {
+	static thread_local RandomEngine engine;
+	return engine;
+}
+
+BigInt randBigInt(BigInt p) {
+	return threadRandomEngine().uniformBelow(p);
+}
+
+
+bool testPrimeMillerRabin(BigInt a, long long countRetry = 10) {
+	if (a == 2 || a == 3) {
+		return true;
+	}
+	if (a == 1 || a % 2 == 0 || a % 3 == 0) {
+		return false;
+	}
+
+	BigInt q = a - 1;
+	int n = 0;
+	while (q % 2 == 0) {
+		q = q / 2;
+		n++;
+	}
+	MontgomeryContext ctx(a);
+	MontgomeryForm one = ctx.getOne();
+	MontgomeryForm t = ctx.sub(ctx.getZero(), one);
+	for (long long i = 0; i < countRetry; i++) {
+		BigInt k = randBigInt(a - 2) + 2;
+		MontgomeryForm b = ctx.pow(ctx.toMont(k), q);
+		if (b == one || b == t) {
+			continue;
+		}
+		int j = 0;
+		while (j < n) {
+			b = ctx.sqr(b);
+			if (b == t) {
+				break;
+			}
+			j++;
+		}
+		if (j < n) {
+			continue;
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool testPrimeFermat(const BigInt& n, const MontgomeryContext& ctx) {
+	return ctx.pow(ctx.toMont(2), n - 1) == ctx.getOne();
+}
+
+static const long long RHO_BLOCK_SIZE = 100;
+static const int RHO_TRIAL_DIVISION_LIMIT = 1000;
+
+// same budget of x^2 + c evaluations as n^(1/4) rounds of Floyd's three
+static long long rhoIterationsCount(BigInt n) {
+	BigInt count = 3 * ((n.sqrt()).sqrt() + 2);
+	if (count >= 1000000000000000000LL) {
+		return 1000000000000000000LL;
+	}
+	vector<long long> digits = count.getDigits();
+	return digits.size() == 1 ? digits[0] : digits[1] * BigInt::BASE + digits[0];
+}
+
+// Brent's cycle detection for x -> x^2 + c: |x - y| is accumulated in a product
+// over blocks of RHO_BLOCK_SIZE steps and only the block gets a gcd
+BigInt rhoPollardDivisor(BigInt n, long long iterationsCount, BigInt c, const atomic<bool>* stop) {
+	if (n.mod2() == 0) {
+		return 2;
+	}
+	MontgomeryContext ctx(n);
+	vector<unsigned int> nWords = n.toWords();
+	vector<unsigned int> oneWords(1, 1);
+	MontgomeryForm cm = ctx.toMont(c);
+	MontgomeryForm y = ctx.toMont(randBigInt(n));
+	MontgomeryForm x, ys;
+	MontgomeryForm q = ctx.getOne();
+	vector<unsigned int> g = oneWords;
+
+	long long steps = 0;
+	for (long long r = 1; g == oneWords && steps < iterationsCount && !(stop && *stop); r *= 2) {
+		x = y;
+		for (long long i = 0; i < r; i++) {
+			y = ctx.add(ctx.sqr(y), cm);
+		}
+		steps += r;
+		for (long long k = 0; k < r && g == oneWords && !(stop && *stop); k += RHO_BLOCK_SIZE) {
+			ys = y;
+			long long block = min(RHO_BLOCK_SIZE, r - k);
+			for (long long i = 0; i < block; i++) {
+				y = ctx.add(ctx.sqr(y), cm);
+				q = ctx.mul(q, ctx.sub(x, y));
+			}
+			steps += block;
+			g = gcdWords(q, nWords);
+		}
+	}
+
+	// the block product hit a multiple of n, redo its steps one gcd at a time
+	if (g == nWords) {
+		do {
+			ys = ctx.add(ctx.sqr(ys), cm);
+			g = gcdWords(ctx.sub(x, ys), nWords);
+		} while (g == oneWords);
+	}
+	return BigInt::fromWords(g);
+}
+
+
+BigInt fPollard(BigInt a, BigInt mod) {
+	return (a * a + 1) % mod;
+}
+
+static MontgomeryForm montPowSmall(const MontgomeryContext& ctx, MontgomeryForm a, unsigned long long e) {
+	MontgomeryForm res = ctx.getOne();
+	while (e != 0) {
+		if (e & 1) {
+			res = ctx.mul(res, a);
+		}
+		a = ctx.sqr(a);
+		e >>= 1;
+	}
+	return res;
+}
+
+// nontrivial gcd(a, n) as a divisor, 1 when a is invertible, n when a = 0 (mod n)
+static BigInt gcdWithModulus(const MontgomeryForm& a, const BigInt& n) {
+	return BigInt::fromWords(gcdWords(a, n.toWords()));
+}
+
+// primes per stage 1 gcd; a gcd of n sends the block back to be replayed one prime at a time
+static const int SMOOTH_GCD_BLOCK = 100;
+
+// gcd of n with the product of a stage 2 block; when that is n every prime of the block went in at once,
+// and the terms alone can still split it
+static BigInt blockGcd(const vector<MontgomeryForm>& terms, const MontgomeryForm& product, const BigInt& n) {
+	BigInt g = gcdWithModulus(product, n);
+	if (g != n) {
+		return g;
+	}
+	for (auto& term : terms) {
+		BigInt d = gcdWithModulus(term, n);
+		if (d != 1 && d != n) {
+			return d;
+		}
+	}
+	return n;
+}
+
+// stage 1 raises 2 to every prime power up to B1, stage 2 covers one more prime q in (B1, B2]
+// stepping between consecutive primes with a table of a^gap
+BigInt pollardPM1Divisor(BigInt n, long long B1, long long B2) {
+	if (n.mod2() == 0) {
+		return 2;
+	}
+	MontgomeryContext ctx(n);
+	vector<int> primes = smallPrimes((int)max(B1, B2));
+	MontgomeryForm one = ctx.getOne();
+	MontgomeryForm a = ctx.toMont(2);
+	MontgomeryForm saved = a;
+	size_t savedIdx = 0;
+	BigInt g = 1;
+	for (size_t i = 0; i < primes.size() && primes[i] <= B1; i++) {
+		unsigned long long pe = primes[i];
+		while (pe * primes[i] <= (unsigned long long)B1) {
+			pe *= primes[i];
+		}
+		a = montPowSmall(ctx, a, pe);
+		if ((i + 1) % SMOOTH_GCD_BLOCK != 0 && i + 1 < primes.size() && primes[i + 1] <= B1) {
+			continue;
+		}
+		g = gcdWithModulus(ctx.sub(a, one), n);
+		if (g == n) {
+			// every p - 1 became smooth inside this block, take it again a prime at a time
+			a = saved;
+			g = 1;
+			for (size_t j = savedIdx; j <= i && g == 1; j++) {
+				for (unsigned long long pk = 1; pk * primes[j] <= (unsigned long long)B1; pk *= primes[j]) {
+					a = montPowSmall(ctx, a, primes[j]);
+					g = gcdWithModulus(ctx.sub(a, one), n);
+					if (g != 1) {
+						break;
+					}
+				}
+			}
+		}
+		if (g != 1) {
+			return g;
+		}
+		saved = a;
+		savedIdx = i + 1;
+	}
+	if (B2 <= B1) {
+		return g;
+	}
+
+	vector<MontgomeryForm> gapPowers(1, one);
+	MontgomeryForm a2 = ctx.sqr(a);
+	MontgomeryForm x, acc = one;
+	vector<MontgomeryForm> terms;
+	long long last = 0;
+	for (int prime : primes) {
+		if (prime <= B1) {
+			continue;
+		}
+		if (last == 0) {
+			x = montPowSmall(ctx, a, prime);
+		}
+		else {
+			long long gap = (prime - last) / 2;
+			while ((long long)gapPowers.size() <= gap) {
+				gapPowers.push_back(ctx.mul(gapPowers.back(), a2));
+			}
+			x = ctx.mul(x, gapPowers[gap]);
+		}
+		last = prime;
+		terms.push_back(ctx.sub(x, one));
+		acc = ctx.mul(acc, terms.back());
+		if (terms.size() == 1000) {
+			g = blockGcd(terms, acc, n);
+			if (g != 1) {
+				return g;
+			}
+			terms.clear();
+		}
+	}
+	return blockGcd(terms, acc, n);
+}
+
+struct MontgomeryCurvePoint {
+	MontgomeryForm x, z;
+};
+
+// x-only arithmetic on By^2 = x^3 + Ax^2 + x, a24 = (A + 2) / 4
+static MontgomeryCurvePoint curveDouble(const MontgomeryContext& ctx, const MontgomeryCurvePoint& p, const MontgomeryForm& a24) {
+	MontgomeryForm t1 = ctx.sqr(ctx.add(p.x, p.z));
+	MontgomeryForm t2 = ctx.sqr(ctx.sub(p.x, p.z));
+	MontgomeryForm t3 = ctx.sub(t1, t2);
+	return { ctx.mul(t1, t2), ctx.mul(t3, ctx.add(t2, ctx.mul(a24, t3))) };
+}
+
+static MontgomeryCurvePoint curveAdd(const MontgomeryContext& ctx, const MontgomeryCurvePoint& p, const MontgomeryCurvePoint& q,
+	const MontgomeryCurvePoint& diff) {
+	MontgomeryForm u = ctx.mul(ctx.sub(p.x, p.z), ctx.add(q.x, q.z));
+	MontgomeryForm v = ctx.mul(ctx.add(p.x, p.z), ctx.sub(q.x, q.z));
+	return { ctx.mul(diff.z, ctx.sqr(ctx.add(u, v))), ctx.mul(diff.x, ctx.sqr(ctx.sub(u, v))) };
+}
+
+static MontgomeryCurvePoint curveLadder(const MontgomeryContext& ctx, unsigned long long k, const MontgomeryCurvePoint& p,
+	const MontgomeryForm& a24) {
+	if (k == 1) {
+		return p;
+	}
+	int top = 63;
+	while (((k >> top) & 1) == 0) {
+		top--;
+	}
+	MontgomeryCurvePoint r0 = p;
+	MontgomeryCurvePoint r1 = curveDouble(ctx, p, a24);
+	for (int i = top - 1; i >= 0; i--) {
+		if ((k >> i) & 1) {
+			r0 = curveAdd(ctx, r1, r0, p);
+			r1 = curveDouble(ctx, r1, a24);
+		}
+		else {
+			r1 = curveAdd(ctx, r0, r1, p);
+			r0 = curveDouble(ctx, r0, a24);
+		}
+	}
+	return r0;
+}
+
+static const int ECM_STAGE2_D = 2310;
+
+// one curve of Lenstra's method with Suyama's parametrization; returns n when the curve fails
+static BigInt ecmCurve(const MontgomeryContext& ctx, const BigInt& n, long long B1, long long B2, const vector<int>& primes) {
+	BigInt sigma = 6 + randBigInt(n - 6);
+	MontgomeryForm s = ctx.toMont(sigma);
+	MontgomeryForm u = ctx.sub(ctx.sqr(s), ctx.toMont(5));
+	MontgomeryForm v = ctx.mul(ctx.toMont(4), s);
+	MontgomeryForm u3 = ctx.mul(ctx.sqr(u), u);
+	MontgomeryForm vu = ctx.sub(v, u);
+	MontgomeryForm num = ctx.mul(ctx.mul(ctx.sqr(vu), vu), ctx.add(ctx.mul(ctx.toMont(3), u), v));
+	MontgomeryForm den = ctx.mul(ctx.mul(ctx.toMont(16), u3), v);
+
+	BigInt denValue = ctx.fromMont(den);
+	BigInt g = binaryGcd(denValue, n);
+	if (g != 1) {
+		return g;
+	}
+	MontgomeryForm a24 = ctx.mul(num, ctx.toMont(reverse_modulo(denValue, n)));
+	MontgomeryCurvePoint q = { u3, ctx.mul(ctx.sqr(v), v) };
+
+	MontgomeryCurvePoint saved = q;
+	size_t savedIdx = 0;
+	for (size_t i = 0; i < primes.size() && primes[i] <= B1; i++) {
+		unsigned long long pe = primes[i];
+		while (pe * primes[i] <= (unsigned long long)B1) {
+			pe *= primes[i];
+		}
+		q = curveLadder(ctx, pe, q, a24);
+		if ((i + 1) % SMOOTH_GCD_BLOCK != 0 && i + 1 < primes.size() && primes[i + 1] <= B1) {
+			continue;
+		}
+		g = gcdWithModulus(q.z, n);
+		if (g == n) {
+			// the group orders mod every prime factor went smooth inside this block, take it again a prime at a time
+			q = saved;
+			g = 1;
+			for (size_t j = savedIdx; j <= i && g == 1; j++) {
+				for (unsigned long long pk = 1; pk * primes[j] <= (unsigned long long)B1; pk *= primes[j]) {
+					q = curveLadder(ctx, primes[j], q, a24);
+					g = gcdWithModulus(q.z, n);
+					if (g != 1) {
+						break;
+					}
+				}
+			}
+		}
+		if (g != 1) {
+			return g;
+		}
+		saved = q;
+		savedIdx = i + 1;
+	}
+	if (B2 <= B1) {
+		return g;
+	}
+
+	// stage 2: a prime m * D +- j is caught by x(mDQ) * z(jQ) - x(jQ) * z(mDQ); the first giant step is the
+	// one whose window holds B1, and primes below it (only when B1 < D / 2) are caught by z(jQ) alone
+	int half = ECM_STAGE2_D / 2;
+	vector<MontgomeryCurvePoint> baby(half + 1);
+	baby[1] = q;
+	baby[2] = curveDouble(ctx, q, a24);
+	for (int j = 3; j <= half; j++) {
+		baby[j] = curveAdd(ctx, baby[j - 1], q, baby[j - 2]);
+	}
+
+	long long m = max(1LL, (B1 + half) / ECM_STAGE2_D);
+	MontgomeryCurvePoint dq = curveLadder(ctx, ECM_STAGE2_D, q, a24);
+	MontgomeryCurvePoint cur = m == 1 ? dq : curveLadder(ctx, m * ECM_STAGE2_D, q, a24);
+	MontgomeryCurvePoint prev = m == 1 ? dq : curveLadder(ctx, (m - 1) * ECM_STAGE2_D, q, a24);
+
+	MontgomeryForm acc = ctx.getOne();
+	vector<MontgomeryForm> terms;
+	vector<bool> used(half + 1);
+	size_t idx = 0;
+	while (idx < primes.size() && primes[idx] <= B1) {
+		idx++;
+	}
+	for (; idx < primes.size() && primes[idx] <= B2; m++) {
+		long long center = m * ECM_STAGE2_D;
+		fill(used.begin(), used.end(), false);
+		terms.clear();
+		while (idx < primes.size() && primes[idx] <= B2 && primes[idx] <= center + half) {
+			long long prime = primes[idx++];
+			long long j = prime < center ? center - prime : prime - center;
+			if (prime < center - half) {
+				terms.push_back(baby[prime].z);
+			}
+			else if (j == 0 || j > half || used[j]) {
+				continue;
+			}
+			else {
+				used[j] = true;
+				terms.push_back(ctx.sub(ctx.mul(cur.x, baby[j].z), ctx.mul(baby[j].x, cur.z)));
+			}
+			acc = ctx.mul(acc, terms.back());
+		}
+		g = blockGcd(terms, acc, n);
+		if (g != 1) {
+			return g;
+		}
+		MontgomeryCurvePoint next = m == 1 ? curveDouble(ctx, cur, a24) : curveAdd(ctx, cur, dq, prev);
+		prev = cur;
+		cur = next;
+	}
+	return 1;
+}
+
+BigInt ecmDivisor(BigInt n, long long B1, long long B2, int curves) {
+	if (n.mod2() == 0) {
+		return 2;
+	}
+	MontgomeryContext ctx(n);
+	vector<int> primes = smallPrimes((int)max(B1, B2));
+	for (int i = 0; i < curves; i++) {
+		BigInt g = ecmCurve(ctx, n, B1, B2, primes);
+		if (g > 1 && g < n) {
+			return g;
+		}
+	}
+	return n;
+}
+
+/*
+ * self-initializing quadratic sieve
+ */
+static const int SIQS_BLOCK_SIZE = 32768;
+static const int SIQS_SMALL_PRIME = 30;
+static const int SIQS_EXTRA_RELATIONS = 32;
+static const int SIQS_THRESHOLD_FUDGE = 16;
+
+struct SiqsParameters {
+	int bits;
+	int factorBaseSize;
+	int blocks;
+	int largePrimeMultiplier;
+};
+
+// by the bit length of n; sieve interval is [-M, M) with M = blocks * SIQS_BLOCK_SIZE. Tuned on one core at
+// 50, 54, 60 and 70 digits: a larger factor base and large prime bound beat a wider interval
+static const SiqsParameters SIQS_PARAMETERS[] = {
+	{ 100, 100, 1, 30 }, { 130, 220, 1, 50 }, { 160, 600, 1, 80 }, { 175, 1000, 1, 100 },
+	{ 190, 1600, 1, 200 }, { 200, 3000, 1, 600 }, { 220, 4000, 2, 500 }, { 240, 6000, 2, 600 }, { 260, 8000, 3, 800 },
+	{ 280, 10000, 4, 1000 }, { 300, 12500, 5, 1200 }, { 330, 16000, 6, 1500 }
+};
+
+static SiqsParameters siqsParameters(long long bits) {
+	for (auto params : SIQS_PARAMETERS) {
+		if (bits <= params.bits) {
+			return params;
+		}
+	}
+	return SIQS_PARAMETERS[sizeof(SIQS_PARAMETERS) / sizeof(SIQS_PARAMETERS[0]) - 1];
+}
+
+// Y^2 = product of the factor base entries (index 0 stands for -1) times the squares of largePrimes, mod kn
+struct SiqsRelation {
+	vector<BigInt> ys;
+	vector<int> factors;
+	vector<long long> largePrimes;
+};
+
+struct SiqsContext {
+	BigInt n, kn;
+	long long M;
+	vector<int> primes;
+	vector<int> sqrtKn;
+	vector<unsigned char> logp;
+	// ceil(2^64 / p): v < 2^32 is a multiple of p exactly when v * inverse <= inverse - 1
+	vector<unsigned long long> inverse;
+	int sieveStart;
+	int threshold;
+	long long largePrimeBound;
+
+	int s;
+	double targetABits;
+	vector<int> aPool;
+
+	mutex lock;
+	vector<SiqsRelation> relations;
+	map<long long, SiqsRelation> partials;
+	set<vector<int>> usedA;
+	size_t needed;
+	atomic<bool> done;
+};
+
+// Knuth-Schroeppel: prefer k for which many small primes have (kn / p) = 1
+static int siqsMultiplier(const BigInt& n) {
+	static const int multipliers[] = { 1, 3, 5, 7, 11, 13, 15, 17, 19, 21, 23, 29, 31, 33, 35, 37, 39, 41, 43, 47,
+		51, 53, 55, 57, 59, 61, 65, 67, 69, 71, 73 };
+	vector<int> primes = smallPrimes(2000);
+	vector<long long> nMod(primes.size());
+	for (long long i = 0; i < (long long)primes.size(); i++) {
+		nMod[i] = n.modSmall(primes[i]);
+	}
+	long long n8 = n.modSmall(8);
+
+	int best = 1;
+	double bestScore = -1e100;
+	for (int k : multipliers) {
+		long long kn8 = k * n8 % 8;
+		double score = -0.5 * log((double)k);
+		if (kn8 == 1) {
+			score += 2 * log(2.0);
+		}
+		else if (kn8 == 5) {
+			score += log(2.0);
+		}
+		else if (kn8 == 3 || kn8 == 7) {
+			score += 0.5 * log(2.0);
+		}
+		for (long long i = 1; i < (long long)primes.size(); i++) {
+			long long p = primes[i];
+			long long knp = nMod[i] * k % p;
+			if (knp == 0) {
+				score += log((double)p) / p;
+			}
+			else if (powModSmall(knp, (p - 1) / 2, p) == 1) {
+				score += 2 * log((double)p) / (p - 1);
+			}
+		}
+		if (score > bestScore) {
+			bestScore = score;
+			best = k;
+		}
+	}
+	return best;
+}
+
+// factor base of primes with (kn / p) != -1, a prime factor of n found on the way is returned instead
+static BigInt siqsBuildFactorBase(SiqsContext& ctx, int factorBaseSize) {
+	ctx.primes.assign(1, -1);
+	ctx.sqrtKn.assign(1, 0);
+	for (int p = 2; (int)ctx.primes.size() <= factorBaseSize; p++) {
+		bool isPrime = true;
+		for (int d = 2; d * d <= p && isPrime; d++) {
+			isPrime = p % d != 0;
+		}
+		if (!isPrime) {
+			continue;
+		}
+		if (ctx.n.modSmall(p) == 0) {
+			return p;
+		}
+		long long knp = ctx.kn.modSmall(p);
+		if (p == 2 || knp == 0 || powModSmall(knp, (p - 1) / 2, p) == 1) {
+			ctx.primes.push_back(p);
+			ctx.sqrtKn.push_back((int)sqrtModSmall(knp, p));
+		}
+	}
+	ctx.logp.resize(ctx.primes.size());
+	ctx.inverse.resize(ctx.primes.size());
+	ctx.sieveStart = (int)ctx.primes.size();
+	for (long long i = 1; i < (long long)ctx.primes.size(); i++) {
+		ctx.logp[i] = (unsigned char)(log2((double)ctx.primes[i]) + 0.5);
+		ctx.inverse[i] = ~0ULL / (unsigned long long)ctx.primes[i] + 1;
+		if (ctx.primes[i] >= SIQS_SMALL_PRIME && ctx.sieveStart == (int)ctx.primes.size()) {
+			ctx.sieveStart = (int)i;
+		}
+	}
+	return 1;
+}
+
+// A is a product of s factor base primes close to sqrt(2kn) / M
+static void siqsPrepareA(SiqsContext& ctx) {
+	ctx.targetABits = (ctx.kn.bitLength() + 1) / 2.0 - log2((double)ctx.M);
+	int size = (int)ctx.primes.size();
+	double midBits = log2((double)ctx.primes[size / 2]);
+	ctx.s = max(2, min(20, (int)(ctx.targetABits / midBits + 0.5)));
+	double idealBits = ctx.targetABits / ctx.s;
+
+	for (double width = 1; ctx.aPool.size() < (size_t)ctx.s + 4 && width < 64; width++) {
+		ctx.aPool.clear();
+		for (int i = ctx.sieveStart; i < size; i++) {
+			double bits = log2((double)ctx.primes[i]);
+			if (ctx.sqrtKn[i] != 0 && bits >= idealBits - width && bits <= idealBits + width) {
+				ctx.aPool.push_back(i);
+			}
+		}
+	}
+}
+
+// picks s - 1 random primes of the pool and the prime that brings A closest to its target, never the same A twice
+static vector<int> siqsChooseA(SiqsContext& ctx) {
+	RandomEngine& random = threadRandomEngine();
+	int size = (int)ctx.primes.size();
+	while (true) {
+		vector<int> chosen;
+		double bits = 0;
+		while ((int)chosen.size() < ctx.s - 1) {
+			int idx = ctx.aPool[random.uniformBelow((long long)ctx.aPool.size())];
+			if (find(chosen.begin(), chosen.end(), idx) == chosen.end()) {
+				chosen.push_back(idx);
+				bits += log2((double)ctx.primes[idx]);
+			}
+		}
+		int last = -1;
+		double bestDiff = 1e100;
+		for (int i = ctx.sieveStart; i < size; i++) {
+			double diff = fabs(bits + log2((double)ctx.primes[i]) - ctx.targetABits);
+			if (ctx.sqrtKn[i] != 0 && diff < bestDiff && find(chosen.begin(), chosen.end(), i) == chosen.end()) {
+				bestDiff = diff;
+				last = i;
+			}
+		}
+		chosen.push_back(last);
+		sort(chosen.begin(), chosen.end());
+
+		unique_lock<mutex> guard(ctx.lock);
+		if (ctx.usedA.insert(chosen).second) {
+			return chosen;
+		}
+	}
+}
+
+static void siqsAddRelation(SiqsContext& ctx, SiqsRelation& relation, long long largePrime) {
+	unique_lock<mutex> guard(ctx.lock);
+	if (largePrime == 1) {
+		ctx.relations.push_back(relation);
+	}
+	else {
+		auto it = ctx.partials.find(largePrime);
+		if (it == ctx.partials.end()) {
+			ctx.partials[largePrime] = relation;
+			return;
+		}
+		SiqsRelation combined = it->second;
+		combined.ys.push_back(relation.ys[0]);
+		combined.factors.insert(combined.factors.end(), relation.factors.begin(), relation.factors.end());
+		combined.largePrimes.push_back(largePrime);
+		ctx.relations.push_back(combined);
+	}
+	if (ctx.relations.size() >= ctx.needed) {
+		ctx.done = true;
+	}
+}
+
+// trial division of Q(x) = ((Ax + B)^2 - kn) / A, the sieve roots tell which primes divide it
+static void siqsCheckCandidate(SiqsContext& ctx, long long pos, const BigInt& A, const BigInt& B, const BigInt& C,
+	const vector<int>& aFactors, const vector<bool>& inA, const vector<int>& root1, const vector<int>& root2) {
+	long long x = pos - ctx.M;
+	BigInt Q = (A * x + 2 * B) * x + C;
+	if (Q == 0) {
+		return;
+	}
+	SiqsRelation relation;
+	if (Q < 0) {
+		relation.factors.push_back(0);
+		Q = -Q;
+	}
+	for (int idx : aFactors) {
+		relation.factors.push_back(idx);
+	}
+	unsigned long long u = (unsigned long long)pos;
+	for (int i = 1; i < (int)ctx.primes.size(); i++) {
+		int p = ctx.primes[i];
+		bool divides;
+		if (i < ctx.sieveStart || inA[i] || root1[i] == root2[i]) {
+			divides = Q.modSmall(p) == 0;
+		}
+		else {
+			// pos hits a root exactly when p divides pos + p - root, tested without a division
+			unsigned long long c = ctx.inverse[i];
+			divides = (u + p - root1[i]) * c <= c - 1 || (u + p - root2[i]) * c <= c - 1;
+		}
+		if (!divides) {
+			continue;
+		}
+		while (Q.modSmall(p) == 0) {
+			Q = Q.divSmall(p);
+			relation.factors.push_back(i);
+		}
+	}
+	if (!(Q < ctx.largePrimeBound)) {
+		return;
+	}
+	relation.ys.push_back(A * x + B);
+	if (Q == 1) {
+		siqsAddRelation(ctx, relation, 1);
+	}
+	else {
+		vector<long long> digits = Q.getDigits();
+		siqsAddRelation(ctx, relation, digits.size() == 1 ? digits[0] : digits[1] * BigInt::BASE + digits[0]);
+	}
+}
+
+// one A at a time: all 2^(s-1) B polynomials reached by Gray code, each sieved over [-M, M) in L1-sized blocks
+static void siqsWorker(SiqsContext* context) {
+	SiqsContext& ctx = *context;
+	int size = (int)ctx.primes.size();
+	long long interval = 2 * ctx.M;
+	vector<unsigned char> sieve(SIQS_BLOCK_SIZE);
+	vector<int> soln1(size), soln2(size), root1(size), root2(size), ainv(size);
+	// next sieve positions relative to the current block, next1 <= next2
+	vector<int> next1(size), next2(size);
+	vector<int> shift(size);
+	for (int i = 1; i < size; i++) {
+		shift[i] = (int)(ctx.M % ctx.primes[i]);
+	}
+
+	while (!ctx.done) {
+		vector<int> aFactors = siqsChooseA(ctx);
+		int s = (int)aFactors.size();
+		BigInt A = 1;
+		for (int idx : aFactors) {
+			A = A * ctx.primes[idx];
+		}
+		vector<bool> inA(size, false);
+		vector<BigInt> Bl(s);
+		BigInt B = 0;
+		for (int j = 0; j < s; j++) {
+			int q = ctx.primes[aFactors[j]];
+			inA[aFactors[j]] = true;
+			BigInt Aq = A.divSmall(q);
+			long long gamma = ctx.sqrtKn[aFactors[j]] * inverseModSmall(Aq.modSmall(q), q) % q;
+			if (gamma > q / 2) {
+				gamma = q - gamma;
+			}
+			Bl[j] = Aq * gamma;
+			B = B + Bl[j];
+		}
+
+		vector<vector<int>> bainv2(s, vector<int>(size));
+		for (int i = 1; i < size; i++) {
+			if (inA[i] || i < ctx.sieveStart) {
+				continue;
+			}
+			long long p = ctx.primes[i];
+			ainv[i] = (int)inverseModSmall(A.modSmall(p), p);
+			for (int j = 0; j < s; j++) {
+				bainv2[j][i] = (int)(2 * Bl[j].modSmall(p) * ainv[i] % p);
+			}
+			long long b = B.modSmall(p);
+			soln1[i] = (int)((ctx.sqrtKn[i] - b + 2 * p) % p * ainv[i] % p);
+			soln2[i] = (int)((2 * p - ctx.sqrtKn[i] - b) % p * ainv[i] % p);
+		}
+
+		long long polynomials = 1LL << (s - 1);
+		for (long long l = 0; l < polynomials && !ctx.done; l++) {
+			if (l > 0) {
+				int v = 0;
+				while (((l >> v) & 1) == 0) {
+					v++;
+				}
+				bool negative = ((l >> (v + 1)) & 1) == 0;
+				B = negative ? B - 2 * Bl[v] : B + 2 * Bl[v];
+				for (int i = ctx.sieveStart; i < size; i++) {
+					if (inA[i]) {
+						continue;
+					}
+					int p = ctx.primes[i];
+					int delta = negative ? bainv2[v][i] : p - bainv2[v][i];
+					soln1[i] += delta;
+					soln1[i] -= soln1[i] >= p ? p : 0;
+					soln2[i] += delta;
+					soln2[i] -= soln2[i] >= p ? p : 0;
+				}
+			}
+			// A is a product of factor base primes, so the exact division goes one small prime at a time
+			BigInt C = B * B - ctx.kn;
+			for (int idx : aFactors) {
+				C = C.divSmall(ctx.primes[idx]);
+			}
+
+			for (int i = ctx.sieveStart; i < size; i++) {
+				if (inA[i]) {
+					continue;
+				}
+				int p = ctx.primes[i];
+				root1[i] = soln1[i] + shift[i];
+				root1[i] -= root1[i] >= p ? p : 0;
+				root2[i] = soln2[i] + shift[i];
+				root2[i] -= root2[i] >= p ? p : 0;
+				next1[i] = min(root1[i], root2[i]);
+				next2[i] = max(root1[i], root2[i]);
+			}
+
+			for (long long blockStart = 0; blockStart < interval; blockStart += SIQS_BLOCK_SIZE) {
+				fill(sieve.begin(), sieve.end(), 0);
+				unsigned char* block = sieve.data();
+				for (int i = ctx.sieveStart; i < size; i++) {
+					if (inA[i]) {
+						continue;
+					}
+					int p = ctx.primes[i];
+					unsigned char lp = ctx.logp[i];
+					int pos1 = next1[i];
+					if (next2[i] == pos1) {
+						for (; pos1 < SIQS_BLOCK_SIZE; pos1 += p) {
+							block[pos1] += lp;
+						}
+						next1[i] = next2[i] = pos1 - SIQS_BLOCK_SIZE;
+						continue;
+					}
+					// the roots lie less than p apart, so once the second leaves the block the first has one step left
+					int pos2 = next2[i];
+					for (; pos2 < SIQS_BLOCK_SIZE; pos1 += p, pos2 += p) {
+						block[pos1] += lp;
+						block[pos2] += lp;
+					}
+					if (pos1 < SIQS_BLOCK_SIZE) {
+						block[pos1] += lp;
+						pos1 += p;
+					}
+					next1[i] = min(pos1, pos2) - SIQS_BLOCK_SIZE;
+					next2[i] = max(pos1, pos2) - SIQS_BLOCK_SIZE;
+				}
+				// eight cells at a time: a word goes on to the byte test only if one of its cells can reach the
+				// threshold, a byte above threshold - 1 when that is below 128, a set top bit otherwise
+				const unsigned long long highBits = 0x8080808080808080ULL, ones = 0x0101010101010101ULL;
+				for (int k = 0; k < SIQS_BLOCK_SIZE; k += 8) {
+					unsigned long long word;
+					memcpy(&word, &sieve[k], 8);
+					unsigned long long hit = ctx.threshold <= 128 ? ((word + ones * (128 - ctx.threshold)) | word) & highBits
+						: word & highBits;
+					if (hit == 0) {
+						continue;
+					}
+					for (int j = k; j < k + 8; j++) {
+						if (sieve[j] >= ctx.threshold) {
+							siqsCheckCandidate(ctx, blockStart + j, A, B, C, aFactors, inA, root1, root2);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+// GF(2) elimination on exponent parities with an identity part, rows that reduce to zero are dependencies
+static vector<vector<int>> siqsDependencies(const vector<SiqsRelation>& relations, int columns) {
+	int rows = (int)relations.size();
+	int width = (columns + rows + 63) / 64;
+	vector<vector<unsigned long long>> matrix(rows, vector<unsigned long long>(width, 0));
+	for (int r = 0; r < rows; r++) {
+		for (int idx : relations[r].factors) {
+			matrix[r][idx / 64] ^= 1ULL << (idx % 64);
+		}
+		int id = columns + r;
+		matrix[r][id / 64] |= 1ULL << (id % 64);
+	}
+
+	vector<bool> pivoted(rows, false);
+	for (int c = 0; c < columns; c++) {
+		int pivot = -1;
+		for (int r = 0; r < rows && pivot == -1; r++) {
+			if (!pivoted[r] && ((matrix[r][c / 64] >> (c % 64)) & 1)) {
+				pivot = r;
+			}
+		}
+		if (pivot == -1) {
+			continue;
+		}
+		pivoted[pivot] = true;
+		for (int r = 0; r < rows; r++) {
+			if (r != pivot && ((matrix[r][c / 64] >> (c % 64)) & 1)) {
+				for (int w = c / 64; w < width; w++) {
+					matrix[r][w] ^= matrix[pivot][w];
+				}
+			}
+		}
+	}
+
+	vector<vector<int>> dependencies;
+	for (int r = 0; r < rows; r++) {
+		if (pivoted[r]) {
+			continue;
+		}
+		vector<int> dependency;
+		for (int i = 0; i < rows; i++) {
+			int id = columns + i;
+			if ((matrix[r][id / 64] >> (id % 64)) & 1) {
+				dependency.push_back(i);
+			}
+		}
+		dependencies.push_back(dependency);
+	}
+	return dependencies;
+}
+
+// X = product of the Y's, Y' = square root of the right-hand sides; gcd(X - Y', n) for every dependency
+static BigInt siqsSquareRoot(SiqsContext& ctx, const vector<vector<int>>& dependencies) {
+	MontgomeryContext mont(ctx.n);
+	for (auto& dependency : dependencies) {
+		vector<long long> exponents(ctx.primes.size(), 0);
+		MontgomeryForm x = mont.getOne();
+		MontgomeryForm y = mont.getOne();
+		for (int r : dependency) {
+			const SiqsRelation& relation = ctx.relations[r];
+			for (auto& value : relation.ys) {
+				x = mont.mul(x, mont.toMont(value.abs()));
+			}
+			for (int idx : relation.factors) {
+				exponents[idx]++;
+			}
+			for (long long largePrime : relation.largePrimes) {
+				y = mont.mul(y, mont.toMont(largePrime));
+			}
+		}
+		for (long long i = 1; i < (long long)exponents.size(); i++) {
+			if (exponents[i] > 0) {
+				y = mont.mul(y, mont.pow(mont.toMont(ctx.primes[i]), exponents[i] / 2));
+			}
+		}
+		BigInt g = binaryGcd(mont.fromMont(mont.sub(x, y)), ctx.n);
+		if (g > 1 && g < ctx.n) {
+			return g;
+		}
+	}
+	return ctx.n;
+}
+
+BigInt siqsDivisor(BigInt n, int threads) {
+	if (n.mod2() == 0) {
+		return 2;
+	}
+	BigInt root = n.sqrt();
+	if (root * root == n) {
+		return root;
+	}
+
+	SiqsContext ctx;
+	ctx.n = n;
+	ctx.kn = n * siqsMultiplier(n);
+	SiqsParameters params = siqsParameters(n.bitLength());
+	ctx.M = (long long)params.blocks * SIQS_BLOCK_SIZE;
+	BigInt small = siqsBuildFactorBase(ctx, params.factorBaseSize);
+	if (small != 1) {
+		return small;
+	}
+	long long pmax = ctx.primes.back();
+	ctx.largePrimeBound = pmax * params.largePrimeMultiplier;
+	double logQmax = log2((double)ctx.M) + (ctx.kn.bitLength() - 1) / 2.0;
+	ctx.threshold = (int)(logQmax - log2((double)ctx.largePrimeBound) - SIQS_THRESHOLD_FUDGE);
+	siqsPrepareA(ctx);
+	ctx.needed = ctx.primes.size() + SIQS_EXTRA_RELATIONS;
+	ctx.done = false;
+
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	for (int attempt = 0; attempt < 4; attempt++) {
+		for (int i = 0; i < pool.size(); i++) {
+			pool.submit([&ctx] { siqsWorker(&ctx); });
+		}
+		pool.wait();
+
+		BigInt d = siqsSquareRoot(ctx, siqsDependencies(ctx.relations, (int)ctx.primes.size()));
+		if (d != n) {
+			return d;
+		}
+		ctx.needed += SIQS_EXTRA_RELATIONS;
+		ctx.done = false;
+	}
+	return n;
+}
+
+BigInt findDivisor(BigInt n, const FactorizationConfig& config) {
+	if (n.mod2() == 0) {
+		return 2;
+	}
+	BigInt d;
+	if (n.bitLength() > config.rhoOnlyBits) {
+		if (config.pm1B1 > 0) {
+			d = pollardPM1Divisor(n, config.pm1B1, config.pm1B2);
+			if (d > 1 && d < n) {
+				return d;
+			}
+		}
+		bool useSiqs = config.siqsMinBits > 0 && n.bitLength() >= config.siqsMinBits;
+		for (int i = 0; i < (int)config.ecmLevels.size() && (!useSiqs || i < config.siqsEcmLevels); i++) {
+			EcmLevel level = config.ecmLevels[i];
+			d = ecmDivisor(n, level.B1, level.B2, level.curves);
+			if (d > 1 && d < n) {
+				return d;
+			}
+		}
+		if (useSiqs) {
+			d = siqsDivisor(n, config.siqsThreads);
+			if (d > 1 && d < n) {
+				return d;
+			}
+		}
+	}
+	long long iterationsCount = rhoIterationsCount(n);
+	for (long long i = 0; i < config.rhoRetry; i++) {
+		d = rhoPollardDivisor(n, iterationsCount, 1 + randBigInt(n - 3));
+		if (d > 1 && d < n) {
+			return d;
+		}
+	}
+	return n;
+}
+
+BigInt getDivisor(BigInt n, const FactorizationConfig& config) {
+	if (testPrimeMillerRabin(n)) {
+		return n;
+	}
+	BigInt d = findDivisor(n, config);
+	if (d > 1 && d < n) {
+		return getDivisor(n / d, config);
+	}
+	return n;
+}
+
+BigInt getDivisor(BigInt n, long long countRetry = 10) {
+	FactorizationConfig config;
+	config.rhoRetry = countRetry;
+	return getDivisor(n, config);
+}
+
+
+// small primes (and their powers, which the walks handle poorly) go by trial division
+static void peelSmallPrimes(BigInt& n, vector<pair<BigInt, BigInt>>& factorization) {
+	static const vector<int> trialPrimes = smallPrimes(RHO_TRIAL_DIVISION_LIMIT);
+	for (int prime : trialPrimes) {
+		if (prime == 2 || n.modSmall(prime) != 0) {
+			continue;
+		}
+		factorization.push_back({ prime, 0 });
+		while (n.modSmall(prime) == 0) {
+			n = n / prime;
+			factorization.back().second++;
+		}
+	}
+}
+
+vector<pair<BigInt, BigInt>> rhoPollardFactorization(BigInt n) {
+	return rhoPollardFactorization(n, FactorizationConfig());
+}
+
+vector<pair<BigInt, BigInt>> rhoPollardFactorization(BigInt n, const FactorizationConfig& config) {
+	vector <pair<BigInt, BigInt>> factorization;// <d, pw>
+
+	while (n % 2 == 0) {
+		n = n / 2;
+		if ((long long)factorization.size() == 0) {
+			factorization.push_back({ 2, 1 });
+		}
+		else {
+			factorization[0].second++;
+		}
+	}
+
+	peelSmallPrimes(n, factorization);
+
+	BigInt d = 1;
+	while (n != 1) {
+		d = getDivisor(n, config);
+		factorization.push_back({ d, 0 });
+		while (n % d == 0) {
+			n = n / d;
+			factorization.back().second++;
+		}
+	}
+
+	if (n > 1 || (long long)factorization.size() == 0) {
+		factorization.push_back({ n, 1 });
+	}
+
+	return factorization;
+}
+
+
+struct DivisorSearch {
+	BigInt n;
+	atomic<bool> found;
+	mutex lock;
+	BigInt divisor;
+
+	DivisorSearch(BigInt n_) : n(n_), found(false), divisor(n_) {}
+
+	void report(const BigInt& d) {
+		if (d > 1 && d < n) {
+			unique_lock<mutex> guard(lock);
+			if (!found) {
+				divisor = d;
+				found = true;
+			}
+		}
+	}
+};
+
+// one of walkerCount independent walkers: its share of the ECM curves, then rho with its own constants;
+// levelPrimes[i] are the primes up to max(B1, B2) of ECM level i, sieved once by the driver
+static void divisorWalker(DivisorSearch* search, int walker, int walkerCount, const FactorizationConfig* config,
+	const vector<vector<int>>* levelPrimes) {
+	const BigInt& n = search->n;
+	if (n.bitLength() > config->rhoOnlyBits) {
+		MontgomeryContext ctx(n);
+		if (walker == 0 && config->pm1B1 > 0) {
+			search->report(pollardPM1Divisor(n, config->pm1B1, config->pm1B2));
+		}
+		for (size_t l = 0; l < config->ecmLevels.size(); l++) {
+			const auto& level = config->ecmLevels[l];
+			for (int curve = walker; curve < level.curves && !search->found; curve += walkerCount) {
+				search->report(ecmCurve(ctx, n, level.B1, level.B2, (*levelPrimes)[l]));
+			}
+		}
+	}
+	long long iterationsCount = rhoIterationsCount(n);
+	for (long long i = 0; i < config->rhoRetry && !search->found; i++) {
+		search->report(rhoPollardDivisor(n, iterationsCount, 1 + randBigInt(n - 3), &search->found));
+	}
+}
+
+// every round searches all pending composites at once, the pool threads split between them;
+// the walkers of a composite stop at its first nontrivial divisor and both parts go to the next round
+vector<pair<BigInt, BigInt>> parallelFactorization(BigInt n, int threads, const FactorizationConfig& config) {
+	vector<pair<BigInt, BigInt>> factorization;
+	while (n.mod2() == 0 && n != 0) {
+		n = n / 2;
+		if (factorization.empty()) {
+			factorization.push_back({ 2, 0 });
+		}
+		factorization[0].second++;
+	}
+	peelSmallPrimes(n, factorization);
+
+	// composites only shrink, so the ECM primes are needed at all only when n itself is past rhoOnlyBits
+	vector<vector<int>> levelPrimes;
+	if (n.bitLength() > config.rhoOnlyBits) {
+		for (auto& level : config.ecmLevels) {
+			levelPrimes.push_back(smallPrimes((int)max(level.B1, level.B2)));
+		}
+	}
+
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	vector<BigInt> primes;
+	vector<BigInt> pending;
+	if (n != 1) {
+		pending.push_back(n);
+	}
+	while (!pending.empty()) {
+		vector<unique_ptr<DivisorSearch>> searches;
+		for (auto m : pending) {
+			if (testPrimeMillerRabin(m, 10)) {
+				primes.push_back(m);
+			}
+			else {
+				searches.push_back(unique_ptr<DivisorSearch>(new DivisorSearch(m)));
+			}
+		}
+		pending.clear();
+		for (long long i = 0; i < (long long)searches.size(); i++) {
+			int walkerCount = max(1, pool.size() / (int)searches.size() + (i < pool.size() % (long long)searches.size() ? 1 : 0));
+			for (int walker = 0; walker < walkerCount; walker++) {
+				DivisorSearch* search = searches[i].get();
+				pool.submit([search, walker, walkerCount, &config, &levelPrimes] {
+					divisorWalker(search, walker, walkerCount, &config, &levelPrimes);
+				});
+			}
+		}
+		pool.wait();
+
+		for (auto& search : searches) {
+			if (search->found) {
+				pending.push_back(search->divisor);
+				pending.push_back(search->n / search->divisor);
+			}
+			else {
+				primes.push_back(search->n);
+			}
+		}
+	}
+
+	sort(primes.begin(), primes.end(), [](const BigInt& a, const BigInt& b) { return a < b; });
+	for (long long i = 0; i < (long long)primes.size(); i++) {
+		if (i > 0 && primes[i] == primes[i - 1]) {
+			factorization.back().second++;
+		}
+		else {
+			factorization.push_back({ primes[i], 1 });
+		}
+	}
+	if (factorization.empty()) {
+		factorization.push_back({ n, 1 });
+	}
+	return factorization;
+}
+
+
+/*
+ * baby-step giant-step
+ */
+// open addressing on a 64-bit fingerprint of the Montgomery form, exponent + 1 so that 0 marks an empty slot
+struct BsgsSlot {
+	unsigned long long fingerprint;
+	unsigned long long exponent;
+};
+
+static unsigned long long bsgsFingerprint(const MontgomeryForm& x) {
+	return (unsigned long long)x[0] | ((unsigned long long)(x.size() > 1 ? x[1] : 0) << 32);
+}
+
+static unsigned long long mixFingerprint(unsigned long long fingerprint) {
+	fingerprint ^= fingerprint >> 33;
+	fingerprint *= 0xff51afd7ed558ccdULL;
+	fingerprint ^= fingerprint >> 33;
+	fingerprint *= 0xc4ceb9fe1a85ec53ULL;
+	fingerprint ^= fingerprint >> 33;
+	return fingerprint;
+}
+
+static size_t bsgsSlot(unsigned long long fingerprint, size_t mask) {
+	return (size_t)mixFingerprint(fingerprint) & mask;
+}
+
+BigInt babyStepGiantStepLog(BigInt a, BigInt b, BigInt p) {
+	return babyStepGiantStepLog(a, b, p, p - 1);
+}
+
+// smallest x < order with a^x = b mod p (p odd), -1 if there is none; baby steps a^j go into a table of at most
+// memoryLimit bytes, the giant steps b * a^(-mi) then grow to order / m when the table is capped
+BigInt babyStepGiantStepLog(BigInt a, BigInt b, BigInt p, BigInt order, size_t memoryLimit) {
+	if (p.mod2() == 0 || order < 1) {
+		throw "ValueError";
+	}
+	if (p == 1) {
+		return 0;
+	}
+	MontgomeryContext mont(p);
+	MontgomeryForm aM = mont.toMont(a.mathMod(p));
+	MontgomeryForm bM = mont.toMont(b.mathMod(p));
+
+	BigInt root = order.sqrt() + 1;
+	size_t maxSlots = 1;
+	while (maxSlots * 2 * sizeof(BsgsSlot) <= memoryLimit) {
+		maxSlots *= 2;
+	}
+	// load factor at most 1/2
+	long long m = (long long)(maxSlots / 2);
+	if (root < m) {
+		vector<long long> digits = root.getDigits();
+		m = digits.size() == 1 ? digits[0] : digits[1] * BigInt::BASE + digits[0];
+	}
+	size_t slots = 1;
+	while (slots < 2 * (size_t)m) {
+		slots *= 2;
+	}
+	size_t mask = slots - 1;
+	vector<BsgsSlot> table(slots, BsgsSlot{ 0, 0 });
+
+	MontgomeryForm cur = mont.getOne();
+	for (long long j = 0; j < m; j++) {
+		size_t slot = bsgsSlot(bsgsFingerprint(cur), mask);
+		while (table[slot].exponent != 0) {
+			slot = (slot + 1) & mask;
+		}
+		table[slot] = BsgsSlot{ bsgsFingerprint(cur), (unsigned long long)j + 1 };
+		cur = mont.mul(cur, aM);
+	}
+
+	// cur = a^m now
+	BigInt amInverse = reverse_modulo(mont.fromMont(cur), p);
+	if (amInverse == -1) {
+		return bM == mont.getOne() ? 0 : -1;
+	}
+	MontgomeryForm giant = mont.toMont(amInverse);
+
+	// ceil(order / m) giant steps; a count past 10^18 could never run to the end anyway
+	vector<long long> steps = ((order + m - 1) / m).getDigits();
+	long long giantSteps = steps.size() == 1 ? steps[0] : steps.size() == 2 ? steps[1] * BigInt::BASE + steps[0] : LLONG_MAX;
+	cur = bM;
+	BigInt base = 0;
+	for (long long i = 0; i < giantSteps; i++, base = base + m) {
+		unsigned long long fingerprint = bsgsFingerprint(cur);
+		BigInt best = -1;
+		for (size_t slot = bsgsSlot(fingerprint, mask); table[slot].exponent != 0; slot = (slot + 1) & mask) {
+			if (table[slot].fingerprint != fingerprint) {
+				continue;
+			}
+			BigInt x = base + (long long)(table[slot].exponent - 1);
+			if (x < order && (best == -1 || x < best) && mont.pow(aM, x) == bM) {
+				best = x;
+			}
+		}
+		if (best != -1) {
+			return best;
+		}
+		cur = mont.mul(cur, giant);
+	}
+	return -1;
+}
+
+
+/*
+ * parallel collision search: Pollard rho and kangaroo logs
+ */
+static const int LOG_WALK_STEPS = 32;
+static const int LOG_WALK_STEP_SHIFT = 59;
+static const long long LOG_WALK_BUDGET = 16;
+static const int LOG_WALK_MAX_POINTS_BITS = 14;
+static const long long LOG_COLLISION_CANDIDATES = 1 << 16;
+
+// a = log part, b = second coordinate (rho: exponent of h, kangaroo: herd)
+struct DistinguishedPoint {
+	atomic<unsigned long long> key;
+	atomic<bool> ready;
+	MontgomeryForm point;
+	BigInt a, b;
+};
+
+// open addressing shared by all walkers: a slot is claimed with compare-and-swap on its key and
+// published through ready, so inserts never block each other
+struct DistinguishedPointTable {
+	size_t mask;
+	unique_ptr<DistinguishedPoint[]> slots;
+
+	DistinguishedPointTable(size_t size) : mask(size - 1), slots(new DistinguishedPoint[size]) {
+		for (size_t i = 0; i < size; i++) {
+			slots[i].key.store(0);
+			slots[i].ready.store(false);
+		}
+	}
+
+	// the earlier point with the same value, or nullptr once this one is stored (or the table is full)
+	const DistinguishedPoint* insert(unsigned long long hash, const MontgomeryForm& point, const BigInt& a, const BigInt& b) {
+		unsigned long long key = hash | (1ULL << 63);
+		size_t slot = (size_t)mixFingerprint(hash + 1) & mask;
+		for (size_t probes = 0; probes <= mask; probes++, slot = (slot + 1) & mask) {
+			DistinguishedPoint& entry = slots[slot];
+			unsigned long long current = entry.key.load(memory_order_acquire);
+			if (current == 0) {
+				unsigned long long expected = 0;
+				if (entry.key.compare_exchange_strong(expected, key, memory_order_acq_rel)) {
+					entry.point = point;
+					entry.a = a;
+					entry.b = b;
+					entry.ready.store(true, memory_order_release);
+					return nullptr;
+				}
+				current = expected;
+			}
+			if (current != key) {
+				continue;
+			}
+			while (!entry.ready.load(memory_order_acquire)) {
+				this_thread::yield();
+			}
+			if (entry.point == point) {
+				return &entry;
+			}
+		}
+		return nullptr;
+	}
+};
+
+struct LogWalk {
+	const MontgomeryContext* mont;
+	MontgomeryForm g, h;
+	vector<MontgomeryForm> steps;
+	vector<BigInt> stepA, stepB;
+	unsigned long long dpMask;
+	long long budget;
+	atomic<long long> walked;
+	atomic<bool> done;
+	mutex lock;
+	BigInt result;
+	unique_ptr<DistinguishedPointTable> table;
+
+	LogWalk() : walked(0), done(false), result(-1) {}
+};
+
+// about 2^LOG_WALK_MAX_POINTS_BITS distinguished points per expected sqrt(size) steps, and a table to hold a full budget of them
+static void prepareLogWalk(LogWalk& walk, const MontgomeryContext& mont, BigInt g, BigInt h, BigInt size) {
+	walk.mont = &mont;
+	walk.g = mont.toMont(g.mathMod(mont.getMod()));
+	walk.h = mont.toMont(h.mathMod(mont.getMod()));
+	long long halfBits = (size.bitLength() + 1) / 2;
+	long long dpBits = max(halfBits / 2, halfBits - LOG_WALK_MAX_POINTS_BITS);
+	walk.dpMask = (1ULL << dpBits) - 1;
+	BigInt budget = LOG_WALK_BUDGET * (size.sqrt() + 1);
+	walk.budget = budget.bitLength() < 62 ? (long long)1 << (budget.bitLength() - 1) : (long long)1 << 61;
+	size_t slots = 1024;
+	while ((long long)slots < 2 * LOG_WALK_BUDGET << (halfBits - dpBits)) {
+		slots *= 2;
+	}
+	walk.table.reset(new DistinguishedPointTable(slots));
+}
+
+static bool isLogSolution(LogWalk& walk, const BigInt& x) {
+	return walk.mont->pow(walk.g, x) == walk.h;
+}
+
+static void finishLogWalk(LogWalk& walk, const BigInt& x) {
+	unique_lock<mutex> guard(walk.lock);
+	if (!walk.done) {
+		walk.result = x;
+		walk.done = true;
+	}
+}
+
+// a1 + b1 x = a2 + b2 x mod n has gcd(b2 - b1, n) candidate solutions, each is tried
+static BigInt resolveRhoCollision(LogWalk& walk, const BigInt& order, BigInt a1, BigInt b1, BigInt a2, BigInt b2) {
+	BigInt da = (a1 - a2).mathMod(order);
+	BigInt db = (b2 - b1).mathMod(order);
+	if (db == 0) {
+		return -1;
+	}
+	BigInt d = binaryGcd(db, order);
+	if (da % d != 0 || d > LOG_COLLISION_CANDIDATES) {
+		return -1;
+	}
+	BigInt reduced = order / d;
+	BigInt x = reduced == 1 ? BigInt(0) : (da / d * reverse_modulo(db / d, reduced)).mathMod(reduced);
+	for (BigInt k = 0; k < d; k++, x = x + reduced) {
+		if (isLogSolution(walk, x)) {
+			return x;
+		}
+	}
+	return -1;
+}
+
+// r-adding walk x -> x * g^a_k * h^b_k from a random g^a0 h^b0 up to the next distinguished point;
+// only the step counts are kept, the exponents are rebuilt at the point
+static void rhoLogWalker(LogWalk* context, BigInt order) {
+	LogWalk& walk = *context;
+	const MontgomeryContext& mont = *walk.mont;
+	RandomEngine& random = threadRandomEngine();
+	vector<long long> counts(LOG_WALK_STEPS);
+	long long maxLength = 20 * (long long)(walk.dpMask + 1);
+
+	while (!walk.done && walk.walked < walk.budget) {
+		BigInt a0 = random.uniformBelow(order);
+		BigInt b0 = random.uniformBelow(order);
+		MontgomeryForm x = mont.mul(mont.pow(walk.g, a0), mont.pow(walk.h, b0));
+		fill(counts.begin(), counts.end(), 0);
+
+		long long length = 0;
+		unsigned long long hash = mixFingerprint(bsgsFingerprint(x));
+		while ((hash & walk.dpMask) != 0 && length < maxLength && (length & 1023 || !walk.done)) {
+			int k = (int)(hash >> LOG_WALK_STEP_SHIFT);
+			x = mont.mul(x, walk.steps[k]);
+			counts[k]++;
+			length++;
+			hash = mixFingerprint(bsgsFingerprint(x));
+		}
+		walk.walked += length;
+		if ((hash & walk.dpMask) != 0) {
+			continue;
+		}
+
+		BigInt a = a0, b = b0;
+		for (int k = 0; k < LOG_WALK_STEPS; k++) {
+			a = a + walk.stepA[k] * counts[k];
+			b = b + walk.stepB[k] * counts[k];
+		}
+		a = a % order;
+		b = b % order;
+		const DistinguishedPoint* other = walk.table->insert(hash, x, a, b);
+		if (other != nullptr && other->b != b) {
+			BigInt log = resolveRhoCollision(walk, order, a, b, other->a, other->b);
+			if (log != -1) {
+				finishLogWalk(walk, log);
+			}
+		}
+	}
+}
+
+BigInt rhoPollardLog(BigInt g, BigInt h, BigInt p, BigInt order, int threads) {
+	if (p.mod2() == 0 || order < 1) {
+		throw "ValueError";
+	}
+	MontgomeryContext mont(p);
+	LogWalk walk;
+	prepareLogWalk(walk, mont, g, h, order);
+	if (walk.h == mont.getOne()) {
+		return 0;
+	}
+	for (int k = 0; k < LOG_WALK_STEPS; k++) {
+		walk.stepA.push_back(randBigInt(order));
+		walk.stepB.push_back(randBigInt(order));
+		walk.steps.push_back(mont.mul(mont.pow(walk.g, walk.stepA[k]), mont.pow(walk.h, walk.stepB[k])));
+	}
+
+	int workers = threads > 0 ? threads : defaultThreadCount();
+	ThreadPool pool(workers);
+	for (int i = 0; i < workers; i++) {
+		pool.submit([&walk, order] { rhoLogWalker(&walk, order); });
+	}
+	pool.wait();
+	return walk.result;
+}
+
+struct Kangaroo {
+	MontgomeryForm x;
+	BigInt start;
+	vector<long long> counts;
+	bool wild;
+};
+
+// tame kangaroos start at g^(lower + width/4 + r), wild ones at h * g^r, r < width/2
+static void placeKangaroo(LogWalk& walk, Kangaroo& kangaroo, BigInt lower, BigInt width) {
+	const MontgomeryContext& mont = *walk.mont;
+	BigInt r = threadRandomEngine().uniformBelow(width.div2() + 1);
+	kangaroo.start = kangaroo.wild ? r : lower + width.div2().div2() + r;
+	kangaroo.x = mont.pow(walk.g, kangaroo.start);
+	if (kangaroo.wild) {
+		kangaroo.x = mont.mul(kangaroo.x, walk.h);
+	}
+	kangaroo.counts.assign(LOG_WALK_STEPS, 0);
+}
+
+// every worker drives one tame and one wild kangaroo; a tame/wild meeting gives x = tame distance - wild distance,
+// a kangaroo that lands on its own herd's trail is placed again
+static void kangarooLogWalker(LogWalk* context, BigInt lower, BigInt width) {
+	LogWalk& walk = *context;
+	const MontgomeryContext& mont = *walk.mont;
+	Kangaroo herd[2];
+	for (int i = 0; i < 2; i++) {
+		herd[i].wild = i == 1;
+		placeKangaroo(walk, herd[i], lower, width);
+	}
+
+	long long length = 0;
+	while (!walk.done) {
+		for (Kangaroo& kangaroo : herd) {
+			unsigned long long hash = mixFingerprint(bsgsFingerprint(kangaroo.x));
+			if ((hash & walk.dpMask) == 0) {
+				BigInt distance = kangaroo.start;
+				for (int k = 0; k < LOG_WALK_STEPS; k++) {
+					distance = distance + walk.stepA[k] * kangaroo.counts[k];
+				}
+				const DistinguishedPoint* other = walk.table->insert(hash, kangaroo.x, distance, kangaroo.wild ? 1 : 0);
+				if (other != nullptr && (other->b == 1) != kangaroo.wild) {
+					BigInt log = kangaroo.wild ? other->a - distance : distance - other->a;
+					if (log >= 0 && isLogSolution(walk, log)) {
+						finishLogWalk(walk, log);
+					}
+				}
+				else if (other != nullptr) {
+					placeKangaroo(walk, kangaroo, lower, width);
+					hash = mixFingerprint(bsgsFingerprint(kangaroo.x));
+				}
+			}
+			int k = (int)(hash >> LOG_WALK_STEP_SHIFT);
+			kangaroo.x = mont.mul(kangaroo.x, walk.steps[k]);
+			kangaroo.counts[k]++;
+		}
+		length += 2;
+		if ((length & 1023) == 0 && (walk.walked += 1024) >= walk.budget) {
+			break;
+		}
+	}
+}
+
+BigInt kangarooLog(BigInt g, BigInt h, BigInt p, BigInt lower, BigInt upper, int threads) {
+	if (p.mod2() == 0 || lower < 0 || upper < lower) {
+		throw "ValueError";
+	}
+	MontgomeryContext mont(p);
+	LogWalk walk;
+	BigInt width = upper - lower;
+	prepareLogWalk(walk, mont, g, h, width + 1);
+
+	// jumps average (number of kangaroos) * sqrt(width) / 4
+	int workers = threads > 0 ? threads : defaultThreadCount();
+	BigInt mean = 2 * workers * (width.sqrt() + 1) / 4 + 1;
+	for (int k = 0; k < LOG_WALK_STEPS; k++) {
+		walk.stepA.push_back(1 + randBigInt(2 * mean));
+		walk.steps.push_back(mont.pow(walk.g, walk.stepA[k]));
+	}
+
+	ThreadPool pool(workers);
+	for (int i = 0; i < workers; i++) {
+		pool.submit([&walk, lower, width] { kangarooLogWalker(&walk, lower, width); });
+	}
+	pool.wait();
+	return walk.result;
+}
+
+
+/*
+ * Pohlig-Hellman
+ */
+static const int POHLIG_HELLMAN_BSGS_BITS = 40;
+
+// log of h to a base of prime order q: BSGS while its table stays small, rho logs beyond
+static BigInt primeOrderLog(const BigInt& gamma, const BigInt& h, const BigInt& p, const BigInt& q, int threads) {
+	if (q.bitLength() <= POHLIG_HELLMAN_BSGS_BITS) {
+		return babyStepGiantStepLog(gamma, h, p, q);
+	}
+	return rhoPollardLog(gamma, h, p, q, threads);
+}
+
+// x mod q^e one base-q digit at a time inside the subgroup of order q^e
+static BigInt primePowerLog(const MontgomeryContext& mont, MontgomeryForm g, MontgomeryForm h, const BigInt& p,
+	BigInt q, long long e, int threads) {
+	BigInt qe = q.pow(e);
+	MontgomeryForm gamma = mont.pow(g, qe / q);
+	BigInt x = 0;
+	BigInt qk = 1;
+	for (long long k = 0; k < e; k++) {
+		MontgomeryForm hk = mont.pow(mont.mul(mont.pow(g, (qe - x) % qe), h), qe / qk / q);
+		BigInt digit = primeOrderLog(mont.fromMont(gamma), mont.fromMont(hk), p, q, threads);
+		if (digit == -1) {
+			return -1;
+		}
+		x = x + digit * qk;
+		qk = qk * q;
+	}
+	return x;
+}
+
+BigInt pohligHellmanLog(BigInt g, BigInt h, BigInt p, int threads) {
+	return pohligHellmanLog(g, h, p, factorize(p - 1), threads);
+}
+
+// g^x = h mod p for x modulo the group order f.n (a multiple of the order of g), -1 if there is none;
+// the prime-power subproblems run on the pool and are joined with solveSimpleSystem
+BigInt pohligHellmanLog(BigInt g, BigInt h, BigInt p, const Factorization& order, int threads) {
+	if (p.mod2() == 0) {
+		throw "ValueError";
+	}
+	if (order.primes.empty()) {
+		return 0;
+	}
+	MontgomeryContext mont(p);
+	MontgomeryForm gM = mont.toMont(g.mathMod(p));
+	MontgomeryForm hM = mont.toMont(h.mathMod(p));
+	BigInt n = order.n;
+
+	long long count = order.primes.size();
+	vector<vector<BigInt>> system(count);
+	// the thread budget is split between the subproblems running at once, so the inner rho walks never
+	// multiply it
+	int workers = threads > 0 ? threads : defaultThreadCount();
+	int outer = (int)min((long long)workers, count);
+	ThreadPool pool(outer);
+	for (long long i = 0; i < count; i++) {
+		int inner = workers / outer + (i % outer < workers % outer ? 1 : 0);
+		pool.submit([&, i, inner] {
+			BigInt q = order.primes[i].first;
+			BigInt exponent = order.primes[i].second;
+			long long e = exponent.getDigits()[0];
+			BigInt qe = q.pow(e);
+			MontgomeryForm gq = mont.pow(gM, n / qe);
+			MontgomeryForm hq = mont.pow(hM, n / qe);
+			system[i] = { 1, primePowerLog(mont, gq, hq, p, q, e, inner), qe };
+		});
+	}
+	pool.wait();
+
+	for (auto& row : system) {
+		if (row[1] == -1) {
+			return -1;
+		}
+	}
+	BigInt x = solveSimpleSystem(system).first;
+	return mont.pow(gM, x) == hM ? x : BigInt(-1);
+}
+
+
+/*
+ * factorization cache
+ */
+static const size_t SHARED_FACTORIZATION_CACHE_SIZE = 4096;
+
+FactorizationCache::FactorizationCache(size_t capacity_, const FactorizationConfig& config_) : capacity(capacity_), config(config_), hitCount(0) {}
+
+Factorization FactorizationCache::get(BigInt n) {
+	if (n < 1) {
+		throw "ValueError";
+	}
+	{
+		unique_lock<mutex> guard(lock);
+		auto it = index.find(n);
+		if (it != index.end()) {
+			entries.splice(entries.begin(), entries, it->second);
+			hitCount++;
+			return *it->second;
+		}
+	}
+
+	// factor outside the lock, two threads asking for the same new n both do the work
+	Factorization f;
+	f.n = n;
+	if (n != 1) {
+		f.primes = rhoPollardFactorization(n, config);
+		sort(f.primes.begin(), f.primes.end());
+	}
+
+	unique_lock<mutex> guard(lock);
+	if (capacity == 0 || index.count(n)) {
+		return f;
+	}
+	entries.push_front(f);
+	index[n] = entries.begin();
+	if (entries.size() > capacity) {
+		index.erase(entries.back().n);
+		entries.pop_back();
+	}
+	return f;
+}
+
+void FactorizationCache::clear() {
+	unique_lock<mutex> guard(lock);
+	entries.clear();
+	index.clear();
+}
+
+size_t FactorizationCache::size() {
+	unique_lock<mutex> guard(lock);
+	return entries.size();
+}
+
+size_t FactorizationCache::hits() {
+	unique_lock<mutex> guard(lock);
+	return hitCount;
+}
+
+FactorizationCache& sharedFactorizationCache() {
+	static FactorizationCache cache(SHARED_FACTORIZATION_CACHE_SIZE);
+	return cache;
+}
+
+Factorization factorize(BigInt n) {
+	return sharedFactorizationCache().get(n);
+}
+
+
+BigInt euler(BigInt n) {
+	return euler(factorize(n));
+}
+
+BigInt euler(const Factorization& f) {
+	BigInt ans = 1;
+	for (auto& el : f.primes) {
+		for (BigInt i = 1; i < el.second; i++) {
+			ans = ans * el.first;
+		}
+		ans = ans * (el.first - 1);
+	}
+	return ans;
+}
+
+
+BigInt mobius(BigInt n) {
+	return mobius(factorize(n));
+}
+
+BigInt mobius(const Factorization& f) {
+	for (auto& el : f.primes) {
+		if (el.second > 1) {
+			return 0;
+		}
+	}
+	return (long long)f.primes.size() % 2 == 0 ? 1 : -1;
+}
+
+
+BigInt carmichael(BigInt n) {
+	return carmichael(factorize(n));
+}
+
+// lcm of lambda(p^e): p^(e-1) * (p-1), except 2^(e-2) for powers of two from 8 on
+BigInt carmichael(const Factorization& f) {
+	BigInt ans = 1;
+	for (auto& el : f.primes) {
+		BigInt lambda = el.first - 1;
+		for (BigInt i = 1; i < el.second; i++) {
+			lambda = lambda * el.first;
+		}
+		if (el.first == 2 && el.second >= 3) {
+			lambda = lambda.div2();
+		}
+		ans = ans * lambda / binaryGcd(ans, lambda);
+	}
+	return ans;
+}
+
+
+BigInt divisorCount(const Factorization& f) {
+	BigInt ans = 1;
+	for (auto& el : f.primes) {
+		ans = ans * (el.second + 1);
+	}
+	return ans;
+}
+
+// sigma_k(n) = product of 1 + p^k + p^2k + ... + p^ek
+BigInt divisorSum(const Factorization& f, long long k) {
+	BigInt ans = 1;
+	for (auto& el : f.primes) {
+		BigInt base = el.first;
+		BigInt pk = base.pow(k);
+		BigInt term = 1;
+		BigInt sum = 1;
+		for (BigInt i = 0; i < el.second; i++) {
+			term = term * pk;
+			sum = sum + term;
+		}
+		ans = ans * sum;
+	}
+	return ans;
+}
+
+
+/*
+ * range sieves
+ */
+static const long long RANGE_SIEVE_SEGMENT = 1 << 15;
+static const long long RANGE_SIEVE_MAX = 1000000000000000000LL;
+
+enum class RangeFunction { Euler, Mobius, SmallestPrimeFactor };
+
+// multiplicative build-up over the primes up to sqrt(hi), so the segment needs no divisions;
+// prod[i] collects the part of n made of those primes, what is left over is a single larger prime
+static void sieveSegment(RangeFunction kind, long long lo, long long hi, const vector<int>& primes,
+	vector<long long>& values, vector<long long>& prod) {
+	long long len = hi - lo;
+	values.assign(len, kind == RangeFunction::SmallestPrimeFactor ? 0 : 1);
+	prod.assign(len, 1);
+	for (long long p : primes) {
+		if (p * p >= hi) {
+			break;
+		}
+		for (long long m = (lo + p - 1) / p * p; m < hi; m += p) {
+			long long i = m - lo;
+			if (kind == RangeFunction::Euler) {
+				values[i] *= p - 1;
+				prod[i] *= p;
+			}
+			else if (kind == RangeFunction::Mobius) {
+				values[i] = -values[i];
+				prod[i] *= p;
+			}
+			else if (values[i] == 0) {
+				values[i] = p;
+			}
+		}
+		if (kind == RangeFunction::SmallestPrimeFactor) {
+			continue;
+		}
+		for (long long pk = p * p; pk < hi; pk *= p) {
+			for (long long m = (lo + pk - 1) / pk * pk; m < hi; m += pk) {
+				long long i = m - lo;
+				if (kind == RangeFunction::Euler) {
+					values[i] *= p;
+					prod[i] *= p;
+				}
+				else {
+					values[i] = 0;
+				}
+			}
+			if (pk > hi / p) {
+				break;
+			}
+		}
+	}
+
+	for (long long i = 0; i < len; i++) {
+		long long n = lo + i;
+		if (kind == RangeFunction::Euler) {
+			if (prod[i] != n) {
+				values[i] *= n / prod[i] - 1;
+			}
+		}
+		else if (kind == RangeFunction::Mobius) {
+			if (values[i] != 0 && prod[i] != n) {
+				values[i] = -values[i];
+			}
+		}
+		else if (values[i] == 0) {
+			values[i] = n;
+		}
+	}
+}
+
+// segments go round-robin to the threads, each with its own buffers
+static void rangeSieve(RangeFunction kind, long long from, long long to, const RangeCallback& callback, int threads) {
+	if (from < 1 || to > RANGE_SIEVE_MAX) {
+		throw "ValueError";
+	}
+	if (from > to) {
+		return;
+	}
+	long long root = (long long)sqrtl((long double)to);
+	while (root * root > to) {
+		root--;
+	}
+	while ((root + 1) * (root + 1) <= to) {
+		root++;
+	}
+	vector<int> primes = smallPrimes((int)root);
+
+	long long segments = (to - from) / RANGE_SIEVE_SEGMENT + 1;
+	int workers = (int)min<long long>(threads > 0 ? threads : defaultThreadCount(), segments);
+	ThreadPool pool(workers);
+	for (int w = 0; w < workers; w++) {
+		pool.submit([&, w] {
+			vector<long long> values, prod;
+			for (long long k = w; k < segments; k += workers) {
+				long long lo = from + k * RANGE_SIEVE_SEGMENT;
+				long long hi = min(to + 1, lo + RANGE_SIEVE_SEGMENT);
+				sieveSegment(kind, lo, hi, primes, values, prod);
+				callback(lo, values);
+			}
+		});
+	}
+	pool.wait();
+}
+
+static vector<long long> rangeSieve(RangeFunction kind, long long from, long long to) {
+	vector<long long> result(to >= from ? to - from + 1 : 0);
+	rangeSieve(kind, from, to, [&result, from](long long first, const vector<long long>& values) {
+		copy(values.begin(), values.end(), result.begin() + (first - from));
+	}, 0);
+	return result;
+}
+
+void eulerRange(long long from, long long to, const RangeCallback& callback, int threads) {
+	rangeSieve(RangeFunction::Euler, from, to, callback, threads);
+}
+
+void mobiusRange(long long from, long long to, const RangeCallback& callback, int threads) {
+	rangeSieve(RangeFunction::Mobius, from, to, callback, threads);
+}
+
+void smallestPrimeFactorRange(long long from, long long to, const RangeCallback& callback, int threads) {
+	rangeSieve(RangeFunction::SmallestPrimeFactor, from, to, callback, threads);
+}
+
+vector<long long> eulerRange(long long from, long long to) {
+	return rangeSieve(RangeFunction::Euler, from, to);
+}
+
+vector<long long> mobiusRange(long long from, long long to) {
+	return rangeSieve(RangeFunction::Mobius, from, to);
+}
+
+vector<long long> smallestPrimeFactorRange(long long from, long long to) {
+	return rangeSieve(RangeFunction::SmallestPrimeFactor, from, to);
+}
+
+
+BigInt legendre(BigInt a, BigInt p) {
+	return kronecker(a, p);
+}
+
+
+BigInt jacobi(BigInt n, BigInt m) {
+	return kronecker(n, m);
+}
+
+
+// Kronecker symbol: the factors of two and the signs of n are read off the low bits, the rest is (|a| / odd n)
+int kronecker(BigInt a, BigInt n) {
+	if (n == 0) {
+		return a == 1 || a == -1 ? 1 : 0;
+	}
+	int result = 1;
+	if (n < 0) {
+		n = -n;
+		if (a < 0) {
+			result = -result;
+		}
+	}
+	vector<unsigned int> aw = a.toWords();
+	vector<unsigned int> nw = n.toWords();
+	long long zeros = trailingZeroBits(nw);
+	if (zeros > 0) {
+		if ((aw[0] & 1) == 0) {
+			return 0;
+		}
+		shiftRightWords(nw, zeros);
+		if ((zeros & 1) && ((aw[0] & 7) == 3 || (aw[0] & 7) == 5)) {
+			result = -result;
+		}
+	}
+	if (a < 0 && (nw[0] & 3) == 3) {
+		result = -result;
+	}
+	return result * jacobiWords(aw, nw);
+}
+
+
+pair<BigInt, BigInt> factorization2Primes(BigInt n, const FactorizationConfig& config) {
+	BigInt d = findDivisor(n, config);
+	if (d > 1 && d < n) {
+		return { d, n / d };
+	}
+	return { -1, -1 };
+}
 
 pair<BigInt, BigInt> factorization2Primes(BigInt n, long long countRetry = 10) {
-	BigInt iterationsCount = (n.sqrt()).sqrt() + 2;
-	BigInt d;
+	FactorizationConfig config;
+	config.rhoRetry = countRetry;
+	return factorization2Primes(n, config);
+}
+
+SqrtPolynomial2::SqrtPolynomial2(BigInt x_, BigInt y_, BigInt w_) {
+	this->x = x_;
+	this->y = y_;
+	this->w = w_;
+}
+
+SqrtPolynomial2 SqrtPolynomial2::pow(BigInt n, BigInt mod) {
+	if (mod.mod2() == 0) {
+		throw "ValueError";
+	}
+	return pow(n, MontgomeryContext(mod));
+}
+
+// (x + y sqrt(w))^n in F_p[sqrt(w)], square-and-multiply over the bits of n in Montgomery form
+SqrtPolynomial2 SqrtPolynomial2::pow(BigInt n, const MontgomeryContext& ctx) {
+	if (n < 0) {
+		throw "ValueError";
+	}
+	BigInt mod = ctx.getMod();
+	MontgomeryForm bx = ctx.toMont(x.mathMod(mod));
+	MontgomeryForm by = ctx.toMont(y.mathMod(mod));
+	MontgomeryForm mw = ctx.toMont(w.mathMod(mod));
+	MontgomeryForm rx = ctx.getOne();
+	MontgomeryForm ry = ctx.getZero();
+
+	vector<unsigned int> bits = n.toWords();
+	for (long long i = (long long)bits.size() - 1; i >= 0; i--) {
+		for (int shift = 31; shift >= 0; shift--) {
+			// (rx + ry s)^2 = rx^2 + w ry^2 + 2 rx ry s
+			MontgomeryForm xy = ctx.mul(rx, ry);
+			rx = ctx.add(ctx.sqr(rx), ctx.mul(mw, ctx.sqr(ry)));
+			ry = ctx.add(xy, xy);
+			if ((bits[i] >> shift) & 1) {
+				MontgomeryForm nx = ctx.add(ctx.mul(rx, bx), ctx.mul(mw, ctx.mul(ry, by)));
+				ry = ctx.add(ctx.mul(rx, by), ctx.mul(ry, bx));
+				rx = nx;
+			}
+		}
+	}
+	return SqrtPolynomial2(ctx.fromMont(rx), ctx.fromMont(ry), w);
+}
+
+BigInt SqrtPolynomial2::getX() {
+	return x;
+}
+
+
+/*
+ * modular square roots
+ */
+static const long long SQRT_TONELLI_BITS_PER_STEP = 8;
+
+enum class SqrtModMethod { ThreeModFour, FiveModEight, TonelliShanks, Cipolla };
+
+// everything about p that does not depend on a: the method, its exponent and for Tonelli-Shanks
+// p - 1 = q 2^s with z^q for a non-residue z
+struct SqrtModPlan {
+	BigInt p;
+	MontgomeryContext mont;
+	SqrtModMethod method;
+	BigInt exponent;
+	long long s;
+	MontgomeryForm c;
+
+	SqrtModPlan(BigInt p_) : p(p_), mont(p_), s(0) {
+		if (p.modSmall(4) == 3) {
+			method = SqrtModMethod::ThreeModFour;
+			exponent = (p + 1) / 4;
+			return;
+		}
+		if (p.modSmall(8) == 5) {
+			method = SqrtModMethod::FiveModEight;
+			exponent = (p - 5) / 8;
+			return;
+		}
+		BigInt q = p - 1;
+		while (q.mod2() == 0) {
+			q = q.div2();
+			s++;
+		}
+		// Tonelli-Shanks adds up to s^2 / 2 squarings, Cipolla doubles the cost of one exponentiation
+		if (s * s > SQRT_TONELLI_BITS_PER_STEP * p.bitLength()) {
+			method = SqrtModMethod::Cipolla;
+			exponent = (p + 1) / 2;
+			return;
+		}
+		method = SqrtModMethod::TonelliShanks;
+		exponent = (q - 1) / 2;
+		long long z = 2;
+		while (kronecker(z, p) != -1) {
+			z++;
+		}
+		c = mont.pow(mont.toMont(z), q);
+	}
+};
+
+static BigInt sqrtModWithPlan(const SqrtModPlan& plan, BigInt a) {
+	const MontgomeryContext& mont = plan.mont;
+	const BigInt& p = plan.p;
+	a = a.mathMod(p);
+	if (a == 0) {
+		return 0;
+	}
+	if (kronecker(a, p) != 1) {
+		return -1;
+	}
+	MontgomeryForm am = mont.toMont(a);
+	MontgomeryForm r;
+	if (plan.method == SqrtModMethod::ThreeModFour) {
+		r = mont.pow(am, plan.exponent);
+	}
+	else if (plan.method == SqrtModMethod::FiveModEight) {
+		// Atkin: b = (2a)^((p-5)/8), i = 2ab^2 is a square root of -1, r = ab(i - 1)
+		MontgomeryForm a2 = mont.add(am, am);
+		MontgomeryForm b = mont.pow(a2, plan.exponent);
+		MontgomeryForm i = mont.mul(a2, mont.sqr(b));
+		r = mont.mul(mont.mul(am, b), mont.sub(i, mont.getOne()));
+	}
+	else if (plan.method == SqrtModMethod::TonelliShanks) {
+		MontgomeryForm y = mont.pow(am, plan.exponent);
+		r = mont.mul(am, y);
+		MontgomeryForm b = mont.mul(r, y);
+		MontgomeryForm c = plan.c;
+		long long m = plan.s;
+		while (b != mont.getOne()) {
+			long long i = 0;
+			for (MontgomeryForm t = b; t != mont.getOne() && i < m; i++) {
+				t = mont.sqr(t);
+			}
+			if (i == m) {
+				return -1;
+			}
+			MontgomeryForm t = c;
+			for (long long j = 0; j < m - i - 1; j++) {
+				t = mont.sqr(t);
+			}
+			r = mont.mul(r, t);
+			c = mont.sqr(t);
+			b = mont.mul(b, c);
+			m = i;
+		}
+	}
+	else {
+		BigInt root = cipolla(a, p, mont).first;
+		if (root == -1) {
+			return -1;
+		}
+		r = mont.toMont(root);
+	}
+
+	BigInt root = mont.fromMont(r);
+	BigInt other = p - root;
+	return other < root ? other : root;
+}
+
+// Cipolla: for t with t^2 - a a non-residue, (t + sqrt(t^2 - a))^((p+1)/2) = sqrt(a) lies in F_p
+pair<BigInt, BigInt> cipolla(BigInt a, BigInt p, const MontgomeryContext& ctx, long long countRetry) {
+	a = a.mathMod(p);
 	for (long long i = 0; i < countRetry; i++) {
-		d = rhoPollardDivisor(n, iterationsCount);
-		if (d > 1 && d < n) {
-			return { d, n / d };
+		BigInt t = randBigInt(p);
+		BigInt w = (t * t - a).mathMod(p);
+		if (kronecker(w, p) != -1) {
+			continue;
 		}
+		BigInt root = SqrtPolynomial2(t, 1, w).pow((p + 1) / 2, ctx).getX();
+		if (root.mulBySimpleMod(root, p) != a) {
+			return { -1, -1 };
+		}
+		return { root, (p - root).mathMod(p) };
 	}
 	return { -1, -1 };
 }
 
-SqrtPolynomial2::SqrtPolynomial2(BigInt x_, BigInt y_, BigInt w_) {
-	this->x = x_;
-	this->y = y_;
-	this->w = w_;
+pair<BigInt, BigInt> cipolla(BigInt a, BigInt p, long long countRetry) {
+	return cipolla(a, p, MontgomeryContext(p), countRetry);
 }
 
-SqrtPolynomial2 SqrtPolynomial2::pow(BigInt n, BigInt mod) {
-	if (n == 0) {
-		return SqrtPolynomial2(1, 0, w);
+// a root r <= p - r of a modulo an odd prime p, -1 when a is a non-residue
+BigInt sqrtMod(BigInt a, BigInt p) {
+	if (p == 2) {
+		return a.mathMod(2);
 	}
-	if (n == 1) {
-		return *this;
+	if (p.mod2() == 0 || p < 2) {
+		throw "ValueError";
+	}
+	return sqrtModWithPlan(SqrtModPlan(p), a);
+}
+
+vector<BigInt> sqrtMod(const vector<BigInt>& values, BigInt p) {
+	vector<BigInt> roots;
+	if (p == 2) {
+		for (BigInt a : values) {
+			roots.push_back(a.mathMod(2));
+		}
+		return roots;
+	}
+	if (p.mod2() == 0 || p < 2) {
+		throw "ValueError";
+	}
+	SqrtModPlan plan(p);
+	for (const BigInt& a : values) {
+		roots.push_back(sqrtModWithPlan(plan, a));
+	}
+	return roots;
+}
+
+
+
+
+BigInt hexToBigInt(string s) {
+	BigInt tmp = 1, ans = 0;
+	for (long long i = (long long)s.size() - 1; i >= 0; i--) {
+		char ch = s[i];
+		long long v = 0;
+		if (ch >= '0' && ch <= '9') {
+			v = ch - '0';
+		}
+		else {
+			v = ch - 'A' + 10;
+		}
+		ans = ans + (tmp * v);
+		tmp = tmp * 16;
 	}
-	SqrtPolynomial2 tmp = this->pow(n / 2, mod);
-	SqrtPolynomial2 tmp1((tmp.x * tmp.x % mod + tmp.y * tmp.y * w % mod) % mod, 2 * tmp.x * tmp.y % mod, w);
-	if (n % 2 == 0) {
-		return tmp1;
+	return ans;
+}
+
+
+Point::Point() {
+	x = 0;
+	y = 0;
+	isZero = false;
+}
+
+Point::Point(BigInt x_, BigInt y_) {
+	x = x_;
+	y = y_;
+	isZero = false;
+}
+
+Point::Point(bool isZero_) {
+	x = 0;
+	y = 0;
+	isZero = isZero_;
+}
+
+Point Point::operator - () {
+	if (isZero) {
+		return *this;
 	}
 	else {
-		SqrtPolynomial2 tmp2((tmp1.x * x % mod + tmp1.y * y * w % mod) % mod, (tmp1.x * y % mod + tmp1.y * x % mod) % mod, w);
-		return tmp2;
+		return Point(x, -y);
+	}
+}
+
+BigInt Point::getX() {
+	return x;
+}
+
+BigInt Point::getY() {
+	return y;
+}
+
+bool operator == (Point p1, Point p2) {
+	return p1.x == p2.x && p1.y == p2.y;
+}
+
+bool operator != (Point p1, Point p2) {
+	return !(p1 == p2);
+}
+
+ostream& operator << (ostream& os, Point p1) {
+	os << "(" << p1.x << ", " << p1.y << ")";
+	return os;
+}
+
+
+/*
+ * curve arithmetic
+ */
+
+// (x, y, z) stands for the affine point (x / z^2, y / z^3), t caches a z^4 for doubling (modified
+// Jacobian coordinates); all coordinates are in the Montgomery form of the field
+template <class Element>
+struct JacobianPoint {
+	Element x, y, z, t;
+	bool isZero;
+};
+
+template <class Field>
+class CurveArithmetic : public CurveGroup {
+private:
+	typedef typename Field::Element Element;
+	typedef JacobianPoint<Element> Jacobian;
+
+	// x and y of a point whose z is shared with the other register of the ladder
+	struct CoZPoint {
+		Element x, y;
+	};
+
+	Field f;
+	BigInt p, n;
+	Element aMont, bMont;
+	Point P;
+	// (p + 1) / 4 when p = 3 mod 4, 0 otherwise
+	BigInt sqrtExponent;
+	// 2n above the Hasse bound p + 1 + 2 sqrt(p): the whole group has order n and every point lies in <P>
+	bool cofactorOne;
+	// Lim-Lee comb for P: comb[j] = sum of 2^(i * combSpacing) P over the set bits i of j, affine (z = 1)
+	vector<Jacobian> comb;
+	long long combSpacing;
+	// the same for the last recipient key of encryptBatch
+	Point combYBase;
+	vector<Jacobian> combY;
+
+	Jacobian infinity() const;
+	Jacobian toJacobian(Point p1) const;
+	Point toAffine(const Jacobian& p1) const;
+	void toAffineBatch(vector<Jacobian>& points) const;
+	Jacobian negJacobian(Jacobian p1) const;
+	Jacobian doubleJacobian(const Jacobian& p1) const;
+	Jacobian addJacobian(const Jacobian& p1, const Jacobian& p2) const;
+	Jacobian addMixed(const Jacobian& p1, const Jacobian& p2) const;
+	vector<Jacobian> oddMultiples(const Jacobian& base, int w) const;
+	Jacobian mulWnaf(const vector<int>& digits, const vector<Jacobian>& odd) const;
+	Jacobian mulJacobian(BigInt k, Point p1) const;
+	vector<Jacobian> buildComb(Point base) const;
+	Jacobian mulComb(const vector<Jacobian>& table, BigInt k) const;
+	Point fromNormalized(const Jacobian& p1) const;
+	Jacobian mulStraus(const vector<vector<unsigned int>>& scalars, const vector<Jacobian>& bases, long long bits) const;
+	Jacobian mulPippenger(const vector<vector<unsigned int>>& scalars, const vector<Jacobian>& bases, long long bits,
+		int threads) const;
+	void coZAdd(const CoZPoint& p1, const CoZPoint& p2, Element& z, CoZPoint& sum, CoZPoint* diff,
+		CoZPoint& p1Updated, bool& degenerate) const;
+
+public:
+	CurveArithmetic(BigInt p_, BigInt a_, BigInt b_, BigInt n_, Point P_);
+
+	Point mul(BigInt k, Point p1) override;
+	Point mulLadder(BigInt k, Point p1) override;
+	pair<Point, Point> encrypt(Point M, Point Y, BigInt r) override;
+	Point decrypt(pair<Point, Point> c, BigInt k) override;
+	vector<pair<Point, Point>> encryptBatch(const vector<Point>& messages, Point Y, const vector<BigInt>& r,
+		int threads) override;
+	vector<Point> decryptBatch(const vector<pair<Point, Point>>& c, BigInt k, int threads) override;
+	Point multiScalarMul(const vector<BigInt>& k, const vector<Point>& points, int threads) override;
+	BigInt curveEquation(BigInt x) override;
+	BigInt curveSqrt(BigInt x) override;
+	bool isOnCurve(Point p1) override;
+	vector<Point> getComb() override;
+	bool setComb(const vector<Point>& table) override;
+};
+
+static const int ELGAMAL_COMB_WIDTH = 6;
+static const size_t MSM_STRAUS_TERMS = 3;
+
+template <class Field>
+CurveArithmetic<Field>::CurveArithmetic(BigInt p_, BigInt a_, BigInt b_, BigInt n_, Point P_) : f(p_) {
+	p = p_;
+	n = n_;
+	P = P_;
+	aMont = f.toMont(a_);
+	bMont = f.toMont(b_);
+	sqrtExponent = p % 4 == 3 ? (p + 1) / 4 : BigInt(0);
+	BigInt excess = n * 2 - p - 1;
+	cofactorOne = excess > 0 && excess * excess > p * 4;
+	combSpacing = (n.bitLength() + ELGAMAL_COMB_WIDTH - 1) / ELGAMAL_COMB_WIDTH;
+}
+
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::infinity() const {
+	Jacobian res = Jacobian();
+	res.isZero = true;
+	return res;
+}
+
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::toJacobian(Point p1) const {
+	if (p1.isZero) {
+		return infinity();
+	}
+	Jacobian res;
+	res.isZero = false;
+	res.x = f.toMont(p1.x);
+	res.y = f.toMont(p1.y);
+	res.z = f.getOne();
+	res.t = aMont;
+	return res;
+}
+
+template <class Field>
+Point CurveArithmetic<Field>::toAffine(const Jacobian& p1) const {
+	if (p1.isZero) {
+		return Point(true);
+	}
+	Element zInv = f.pow(p1.z, p - 2);
+	Element zInv2 = f.sqr(zInv);
+	BigInt x = f.fromMont(f.mul(p1.x, zInv2));
+	BigInt y = f.fromMont(f.mul(p1.y, f.mul(zInv2, zInv)));
+	return Point(x, y);
+}
+
+// Montgomery's trick: one inversion for the whole vector, points at infinity are left as they are
+template <class Field>
+void CurveArithmetic<Field>::toAffineBatch(vector<Jacobian>& points) const {
+	vector<Element> prefix(points.size() + 1);
+	prefix[0] = f.getOne();
+	for (size_t i = 0; i < points.size(); i++) {
+		prefix[i + 1] = points[i].isZero ? prefix[i] : f.mul(prefix[i], points[i].z);
+	}
+	Element inv = f.pow(prefix.back(), p - 2);
+	for (size_t i = points.size(); i-- > 0;) {
+		if (points[i].isZero) {
+			continue;
+		}
+		Element zInv = f.mul(inv, prefix[i]);
+		inv = f.mul(inv, points[i].z);
+		Element zInv2 = f.sqr(zInv);
+		points[i].x = f.mul(points[i].x, zInv2);
+		points[i].y = f.mul(points[i].y, f.mul(zInv2, zInv));
+		points[i].z = f.getOne();
+		points[i].t = aMont;
+	}
+}
+
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::negJacobian(Jacobian p1) const {
+	if (!p1.isZero) {
+		p1.y = f.sub(f.getZero(), p1.y);
+	}
+	return p1;
+}
+
+// M = 3 x^2 + a z^4, S = 4 x y^2: x' = M^2 - 2 S, y' = M (S - x') - 8 y^4, z' = 2 y z, t' = 16 y^4 t
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::doubleJacobian(const Jacobian& p1) const {
+	if (p1.isZero || p1.y == f.getZero()) {
+		return infinity();
+	}
+	Element xx = f.sqr(p1.x);
+	Element yy = f.sqr(p1.y);
+	Element m = f.add(f.add(f.add(xx, xx), xx), p1.t);
+	Element s = f.mul(p1.x, yy);
+	s = f.add(s, s);
+	s = f.add(s, s);
+	Element u = f.sqr(yy);
+	u = f.add(u, u);
+	u = f.add(u, u);
+	u = f.add(u, u);
+
+	Jacobian res;
+	res.isZero = false;
+	res.x = f.sub(f.sqr(m), f.add(s, s));
+	res.y = f.sub(f.mul(m, f.sub(s, res.x)), u);
+	res.z = f.mul(p1.y, p1.z);
+	res.z = f.add(res.z, res.z);
+	res.t = f.mul(u, p1.t);
+	res.t = f.add(res.t, res.t);
+	return res;
+}
+
+// H = u2 - u1, r = s2 - s1 with u_i = x_i z_j^2, s_i = y_i z_j^3:
+// x3 = r^2 - H^3 - 2 u1 H^2, y3 = r (u1 H^2 - x3) - s1 H^3, z3 = z1 z2 H
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::addJacobian(const Jacobian& p1, const Jacobian& p2) const {
+	if (p1.isZero) {
+		return p2;
+	}
+	if (p2.isZero) {
+		return p1;
+	}
+	Element z1z1 = f.sqr(p1.z);
+	Element z2z2 = f.sqr(p2.z);
+	Element u1 = f.mul(p1.x, z2z2);
+	Element u2 = f.mul(p2.x, z1z1);
+	Element s1 = f.mul(p1.y, f.mul(p2.z, z2z2));
+	Element s2 = f.mul(p2.y, f.mul(p1.z, z1z1));
+	Element h = f.sub(u2, u1);
+	Element r = f.sub(s2, s1);
+	if (h == f.getZero()) {
+		return r == f.getZero() ? doubleJacobian(p1) : infinity();
+	}
+	Element hh = f.sqr(h);
+	Element hhh = f.mul(h, hh);
+	Element v = f.mul(u1, hh);
+
+	Jacobian res;
+	res.isZero = false;
+	res.x = f.sub(f.sub(f.sqr(r), hhh), f.add(v, v));
+	res.y = f.sub(f.mul(r, f.sub(v, res.x)), f.mul(s1, hhh));
+	res.z = f.mul(f.mul(p1.z, p2.z), h);
+	res.t = f.mul(aMont, f.sqr(f.sqr(res.z)));
+	return res;
+}
+
+// addJacobian with z2 = 1
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::addMixed(const Jacobian& p1, const Jacobian& p2) const {
+	if (p1.isZero) {
+		return p2;
+	}
+	if (p2.isZero) {
+		return p1;
+	}
+	Element z1z1 = f.sqr(p1.z);
+	Element u2 = f.mul(p2.x, z1z1);
+	Element s2 = f.mul(p2.y, f.mul(p1.z, z1z1));
+	Element h = f.sub(u2, p1.x);
+	Element r = f.sub(s2, p1.y);
+	if (h == f.getZero()) {
+		return r == f.getZero() ? doubleJacobian(p1) : infinity();
+	}
+	Element hh = f.sqr(h);
+	Element hhh = f.mul(h, hh);
+	Element v = f.mul(p1.x, hh);
+
+	Jacobian res;
+	res.isZero = false;
+	res.x = f.sub(f.sub(f.sqr(r), hhh), f.add(v, v));
+	res.y = f.sub(f.mul(r, f.sub(v, res.x)), f.mul(p1.y, hhh));
+	res.z = f.mul(p1.z, h);
+	res.t = f.mul(aMont, f.sqr(f.sqr(res.z)));
+	return res;
+}
+
+// width-w NAF of k, least significant digit first: every digit is 0 or odd with |d| < 2^(w - 1) and of
+// any w consecutive digits at most one is non-zero
+static vector<int> wnafDigits(vector<unsigned int> words, int w) {
+	vector<int> digits;
+	digits.reserve(words.size() * 32 + 1);
+	while (!words.empty()) {
+		int d = 0;
+		if (words[0] & 1) {
+			d = words[0] & ((1 << w) - 1);
+			if (d >= 1 << (w - 1)) {
+				d -= 1 << w;
+			}
+			if (d > 0) {
+				// the low w bits are d itself, no borrow
+				words[0] -= d;
+			}
+			else {
+				unsigned long long carry = -d;
+				for (size_t i = 0; i < words.size() && carry != 0; i++) {
+					unsigned long long v = words[i] + carry;
+					words[i] = (unsigned int)v;
+					carry = v >> 32;
+				}
+				if (carry != 0) {
+					words.push_back((unsigned int)carry);
+				}
+			}
+		}
+		digits.push_back(d);
+		for (size_t i = 0; i < words.size(); i++) {
+			words[i] = (words[i] >> 1) | (i + 1 < words.size() ? words[i + 1] << 31 : 0);
+		}
+		while (!words.empty() && words.back() == 0) {
+			words.pop_back();
+		}
+	}
+	return digits;
+}
+
+static int wnafWidth(long long bits) {
+	return bits <= 64 ? 3 : bits <= 192 ? 4 : bits <= 512 ? 5 : 6;
+}
+
+// base, 3 base, ..., (2^(w - 1) - 1) base, still projective
+template <class Field>
+vector<JacobianPoint<typename Field::Element>> CurveArithmetic<Field>::oddMultiples(const Jacobian& base, int w) const {
+	vector<Jacobian> odd(1 << (w - 2));
+	odd[0] = base;
+	Jacobian twice = doubleJacobian(base);
+	for (size_t i = 1; i < odd.size(); i++) {
+		odd[i] = addJacobian(odd[i - 1], twice);
+	}
+	return odd;
+}
+
+// odd must be affine for the mixed additions
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::mulWnaf(const vector<int>& digits, const vector<Jacobian>& odd) const {
+	Jacobian res = infinity();
+	for (size_t i = digits.size(); i-- > 0;) {
+		res = doubleJacobian(res);
+		if (digits[i] > 0) {
+			res = addMixed(res, odd[digits[i] / 2]);
+		}
+		else if (digits[i] < 0) {
+			res = addMixed(res, negJacobian(odd[-digits[i] / 2]));
+		}
+	}
+	return res;
+}
+
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::mulJacobian(BigInt k, Point p1) const {
+	if (k < 0) {
+		k = -k;
+		p1 = -p1;
+	}
+	Jacobian base = toJacobian(p1);
+	if (base.isZero || k == 0) {
+		return infinity();
+	}
+	int w = wnafWidth(k.bitLength());
+	vector<Jacobian> odd = oddMultiples(base, w);
+	toAffineBatch(odd);
+	return mulWnaf(wnafDigits(k.toWords(), w), odd);
+}
+
+// the comb of P is built on first use unless a table was set before, so it is not safe to make the first
+// generator multiplication of an instance from several threads at once
+template <class Field>
+vector<JacobianPoint<typename Field::Element>> CurveArithmetic<Field>::buildComb(Point base) const {
+	vector<Jacobian> rows(ELGAMAL_COMB_WIDTH);
+	rows[0] = toJacobian(base);
+	for (int i = 1; i < ELGAMAL_COMB_WIDTH; i++) {
+		rows[i] = rows[i - 1];
+		for (long long j = 0; j < combSpacing; j++) {
+			rows[i] = doubleJacobian(rows[i]);
+		}
+	}
+
+	vector<Jacobian> table(1 << ELGAMAL_COMB_WIDTH);
+	table[0] = infinity();
+	for (int j = 1, top = 0; j < (1 << ELGAMAL_COMB_WIDTH); j++) {
+		if (j == 2 << top) {
+			top++;
+		}
+		table[j] = addJacobian(table[j ^ (1 << top)], rows[top]);
+	}
+	toAffineBatch(table);
+	return table;
+}
+
+// column i of the comb collects the bits i, i + d, i + 2d, ... of k; combSpacing doublings in total.
+// k is taken mod n, so the base of the table must lie in the subgroup of order n
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::mulComb(const vector<Jacobian>& table, BigInt k) const {
+	if (k < 0 || k >= n) {
+		k = k.mathMod(n);
+	}
+	vector<unsigned int> bits = k.toWords();
+	auto bit = [&](long long i) {
+		return i / 32 < (long long)bits.size() && ((bits[i / 32] >> (i % 32)) & 1);
+	};
+
+	Jacobian res = infinity();
+	for (long long i = combSpacing - 1; i >= 0; i--) {
+		res = doubleJacobian(res);
+		int column = 0;
+		for (int j = 0; j < ELGAMAL_COMB_WIDTH; j++) {
+			column |= bit(i + j * combSpacing) << j;
+		}
+		if (column != 0) {
+			res = addMixed(res, table[column]);
+		}
+	}
+	return res;
+}
+
+// wNAF, or the comb for multiples of P; one inversion in the final toAffine
+template <class Field>
+Point CurveArithmetic<Field>::mul(BigInt k, Point p1) {
+	if (!p1.isZero && p1 == P) {
+		if (comb.empty()) {
+			comb = buildComb(P);
+		}
+		return toAffine(mulComb(comb, k));
+	}
+	return toAffine(mulJacobian(k, p1));
+}
+
+// (p1 + p2, p1 - p2, p1) over the new common z = z (x1 - x2); the difference is only formed when asked for
+template <class Field>
+void CurveArithmetic<Field>::coZAdd(const CoZPoint& p1, const CoZPoint& p2, Element& z, CoZPoint& sum, CoZPoint* diff,
+	CoZPoint& p1Updated, bool& degenerate) const {
+	Element dx = f.sub(p1.x, p2.x);
+	degenerate |= dx == f.getZero();
+	Element c = f.sqr(dx);
+	Element w1 = f.mul(p1.x, c);
+	Element w2 = f.mul(p2.x, c);
+	Element a1 = f.mul(p1.y, f.sub(w1, w2));
+	Element dy = f.sub(p1.y, p2.y);
+	sum.x = f.sub(f.sub(f.sqr(dy), w1), w2);
+	sum.y = f.sub(f.mul(dy, f.sub(w1, sum.x)), a1);
+	if (diff) {
+		Element sy = f.add(p1.y, p2.y);
+		diff->x = f.sub(f.sub(f.sqr(sy), w1), w2);
+		diff->y = f.sub(f.mul(sy, f.sub(w1, diff->x)), a1);
+	}
+	p1Updated.x = w1;
+	p1Updated.y = a1;
+	z = f.mul(z, dx);
+}
+
+// the same sequence of co-Z additions for every scalar of the bit length of n: k is replaced by k + n or
+// k + 2n so that its top bit is always bit bitLength(n), which only holds for points of order dividing n.
+// On a curve with a cofactor p1 is checked for n p1 = O first and points outside <P> go by wNAF; the rare
+// scalars that meet x1 = x2 on the way are redone with wNAF too
+template <class Field>
+Point CurveArithmetic<Field>::mulLadder(BigInt k, Point p1) {
+	if (p1.isZero || p1.y.mathMod(p) == 0) {
+		return mul(k, p1);
+	}
+	if (!cofactorOne && !mulJacobian(n, p1).isZero) {
+		return mul(k, p1);
+	}
+	long long bits = n.bitLength();
+	k = k.mathMod(n) + n;
+	if (k.bitLength() <= bits) {
+		k = k + n;
+	}
+	vector<unsigned int> words = k.toWords();
+
+	// R1 = 2P and R0 = P over z = 2y
+	Element x = f.toMont(p1.x), y = f.toMont(p1.y);
+	Element yy = f.sqr(y);
+	Element s = f.mul(x, yy);
+	s = f.add(s, s);
+	s = f.add(s, s);
+	Element l = f.sqr(yy);
+	l = f.add(l, l);
+	l = f.add(l, l);
+	l = f.add(l, l);
+	Element xx = f.sqr(x);
+	Element m = f.add(f.add(f.add(xx, xx), xx), aMont);
+	CoZPoint R[2];
+	R[1].x = f.sub(f.sqr(m), f.add(s, s));
+	R[1].y = f.sub(f.mul(m, f.sub(s, R[1].x)), l);
+	R[0].x = s;
+	R[0].y = l;
+	Element z = f.add(y, y);
+
+	bool degenerate = false;
+	for (long long i = bits - 1; i >= 0; i--) {
+		int b = (words[i / 32] >> (i % 32)) & 1;
+		CoZPoint sum, diff, rest;
+		coZAdd(R[b], R[1 - b], z, sum, &diff, rest, degenerate);
+		R[1 - b] = sum;
+		R[b] = diff;
+		coZAdd(R[1 - b], R[b], z, sum, nullptr, rest, degenerate);
+		R[b] = sum;
+		R[1 - b] = rest;
+	}
+	if (degenerate) {
+		return mul(k, p1);
+	}
+	Jacobian res;
+	res.isZero = false;
+	res.x = R[0].x;
+	res.y = R[0].y;
+	res.z = z;
+	return toAffine(res);
+}
+
+template <class Field>
+pair<Point, Point> CurveArithmetic<Field>::encrypt(Point M, Point Y, BigInt r) {
+	if (comb.empty()) {
+		comb = buildComb(P);
+	}
+	Jacobian d = mulJacobian(r, Y);
+	Jacobian g = mulComb(comb, r);
+	Jacobian h = addMixed(d, toJacobian(M));
+	return { toAffine(g), toAffine(h) };
+}
+
+template <class Field>
+Point CurveArithmetic<Field>::decrypt(pair<Point, Point> c, BigInt k) {
+	Jacobian s = mulJacobian(k, c.first);
+	Jacobian M = addMixed(negJacobian(s), toJacobian(c.second));
+	return toAffine(M);
+}
+
+// a point already brought to z = 1 by toAffineBatch, no inversion left to do
+template <class Field>
+Point CurveArithmetic<Field>::fromNormalized(const Jacobian& p1) const {
+	if (p1.isZero) {
+		return Point(true);
+	}
+	return Point(f.fromMont(p1.x), f.fromMont(p1.y));
+}
+
+// the messages are split into a few chunks per thread; each chunk takes both products through the combs
+// of P and Y and shares one inversion for all of its 2 * size outputs
+template <class Field>
+vector<pair<Point, Point>> CurveArithmetic<Field>::encryptBatch(const vector<Point>& messages, Point Y,
+	const vector<BigInt>& r, int threads) {
+	if (comb.empty()) {
+		comb = buildComb(P);
+	}
+	if (combY.empty() || combYBase.isZero != Y.isZero || combYBase != Y) {
+		combY = buildComb(Y);
+		combYBase = Y;
+	}
+	size_t count = messages.size();
+	vector<pair<Point, Point>> res(count);
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	size_t chunk = max((size_t)1, (count + 4 * pool.size() - 1) / (4 * pool.size()));
+	for (size_t begin = 0; begin < count; begin += chunk) {
+		size_t end = min(count, begin + chunk);
+		pool.submit([this, &messages, &r, &res, begin, end] {
+			vector<Jacobian> points;
+			points.reserve(2 * (end - begin));
+			for (size_t i = begin; i < end; i++) {
+				points.push_back(mulComb(comb, r[i]));
+				points.push_back(addMixed(mulComb(combY, r[i]), toJacobian(messages[i])));
+			}
+			toAffineBatch(points);
+			for (size_t i = begin; i < end; i++) {
+				res[i] = { fromNormalized(points[2 * (i - begin)]), fromNormalized(points[2 * (i - begin) + 1]) };
+			}
+		});
+	}
+	pool.wait();
+	return res;
+}
+
+// k is recoded once for the whole batch; a chunk normalises the odd multiples of all of its c.first with
+// one inversion and its results with another
+template <class Field>
+vector<Point> CurveArithmetic<Field>::decryptBatch(const vector<pair<Point, Point>>& c, BigInt k, int threads) {
+	if (k < 0 || k >= n) {
+		k = k.mathMod(n);
+	}
+	int w = wnafWidth(k.bitLength());
+	vector<int> digits = wnafDigits(k.toWords(), w);
+	size_t tableSize = (size_t)1 << (w - 2);
+
+	size_t count = c.size();
+	vector<Point> res(count);
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	size_t chunk = max((size_t)1, (count + 4 * pool.size() - 1) / (4 * pool.size()));
+	for (size_t begin = 0; begin < count; begin += chunk) {
+		size_t end = min(count, begin + chunk);
+		pool.submit([this, &c, &digits, &res, w, tableSize, begin, end] {
+			vector<Jacobian> tables;
+			tables.reserve(tableSize * (end - begin));
+			for (size_t i = begin; i < end; i++) {
+				vector<Jacobian> odd = oddMultiples(toJacobian(c[i].first), w);
+				tables.insert(tables.end(), odd.begin(), odd.end());
+			}
+			toAffineBatch(tables);
+
+			vector<Jacobian> points;
+			points.reserve(end - begin);
+			for (size_t i = begin; i < end; i++) {
+				auto first = tables.begin() + tableSize * (i - begin);
+				Jacobian s = mulWnaf(digits, vector<Jacobian>(first, first + tableSize));
+				points.push_back(addMixed(negJacobian(s), toJacobian(c[i].second)));
+			}
+			toAffineBatch(points);
+			for (size_t i = begin; i < end; i++) {
+				res[i] = fromNormalized(points[i - begin]);
+			}
+		});
 	}
+	pool.wait();
+	return res;
 }
 
-BigInt SqrtPolynomial2::getX() {
-	return x;
+// interleaved wNAF: the odd multiples of every base normalised together, one doubling chain for all terms
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::mulStraus(const vector<vector<unsigned int>>& scalars,
+	const vector<Jacobian>& bases, long long bits) const {
+	int w = wnafWidth(bits);
+	size_t tableSize = (size_t)1 << (w - 2);
+	vector<vector<int>> digits;
+	vector<Jacobian> tables;
+	size_t length = 0;
+	for (size_t t = 0; t < bases.size(); t++) {
+		digits.push_back(wnafDigits(scalars[t], w));
+		length = max(length, digits.back().size());
+		vector<Jacobian> odd = oddMultiples(bases[t], w);
+		tables.insert(tables.end(), odd.begin(), odd.end());
+	}
+	toAffineBatch(tables);
+
+	Jacobian res = infinity();
+	for (size_t i = length; i-- > 0;) {
+		res = doubleJacobian(res);
+		for (size_t t = 0; t < bases.size(); t++) {
+			int d = i < digits[t].size() ? digits[t][i] : 0;
+			if (d > 0) {
+				res = addMixed(res, tables[t * tableSize + d / 2]);
+			}
+			else if (d < 0) {
+				res = addMixed(res, negJacobian(tables[t * tableSize + -d / 2]));
+			}
+		}
+	}
+	return res;
 }
 
-
-
-
-BigInt hexToBigInt(string s) {
-	BigInt tmp = 1, ans = 0;
-	for (long long i = (long long)s.size() - 1; i >= 0; i--) {
-		char ch = s[i];
-		long long v = 0;
-		if (ch >= '0' && ch <= '9') {
-			v = ch - '0';
-		}
-		else {
-			v = ch - 'A' + 10;
+// digits of k in base 2^c, each in [-2^(c - 1), 2^(c - 1)], least significant first
+static vector<int> signedWindowDigits(const vector<unsigned int>& words, int c, long long windows) {
+	vector<int> digits(windows);
+	int carry = 0;
+	for (long long j = 0; j < windows; j++) {
+		int v = carry;
+		for (int t = 0; t < c; t++) {
+			long long i = j * c + t;
+			if (i / 32 < (long long)words.size()) {
+				v += ((words[i / 32] >> (i % 32)) & 1) << t;
+			}
 		}
-		ans = ans + (tmp * v);
-		tmp = tmp * 16;
+		carry = v > 1 << (c - 1);
+		digits[j] = carry ? v - (1 << c) : v;
 	}
-	return ans;
+	return digits;
 }
 
+// Pippenger: every window of c bits drops each base into the bucket of its signed digit, the buckets are
+// summed as sum_b b * bucket_b by two running sums, and the windows are joined by c doublings each.
+// c minimises windows * (terms + 2^c), the windows go to the thread pool
+template <class Field>
+JacobianPoint<typename Field::Element> CurveArithmetic<Field>::mulPippenger(const vector<vector<unsigned int>>& scalars,
+	const vector<Jacobian>& bases, long long bits, int threads) const {
+	size_t count = bases.size();
+	int c = 1;
+	double best = -1;
+	for (int t = 1; t <= 16; t++) {
+		double cost = ceil((bits + 1.0) / t) * (count + 2.0 * (1 << (t - 1)));
+		if (best < 0 || cost < best) {
+			best = cost;
+			c = t;
+		}
+	}
+	long long windows = (bits + c) / c;
+	vector<vector<int>> digits(count);
+	for (size_t i = 0; i < count; i++) {
+		digits[i] = signedWindowDigits(scalars[i], c, windows);
+	}
 
-Point::Point() {
-	x = 0;
-	y = 0;
-	isZero = false;
-}
-
-Point::Point(BigInt x_, BigInt y_) {
-	x = x_;
-	y = y_;
-	isZero = false;
-}
+	vector<Jacobian> windowSums(windows);
+	ThreadPool pool(threads > 0 ? threads : defaultThreadCount());
+	for (long long j = 0; j < windows; j++) {
+		pool.submit([this, &bases, &digits, &windowSums, count, c, j] {
+			vector<Jacobian> buckets(((size_t)1 << (c - 1)) + 1, infinity());
+			for (size_t i = 0; i < count; i++) {
+				int d = digits[i][j];
+				if (d > 0) {
+					buckets[d] = addMixed(buckets[d], bases[i]);
+				}
+				else if (d < 0) {
+					buckets[-d] = addMixed(buckets[-d], negJacobian(bases[i]));
+				}
+			}
+			Jacobian running = infinity(), sum = infinity();
+			for (size_t b = buckets.size() - 1; b >= 1; b--) {
+				running = addJacobian(running, buckets[b]);
+				sum = addJacobian(sum, running);
+			}
+			windowSums[j] = sum;
+		});
+	}
+	pool.wait();
 
-Point::Point(bool isZero_) {
-	x = 0;
-	y = 0;
-	isZero = isZero_;
+	Jacobian res = infinity();
+	for (long long j = windows - 1; j >= 0; j--) {
+		for (int t = 0; t < c; t++) {
+			res = doubleJacobian(res);
+		}
+		res = addJacobian(res, windowSums[j]);
+	}
+	return res;
 }
 
-Point Point::operator - () {
-	if (isZero) {
-		return *this;
+// sum of k_i points_i: Straus/Shamir for up to MSM_STRAUS_TERMS terms, Pippenger beyond
+template <class Field>
+Point CurveArithmetic<Field>::multiScalarMul(const vector<BigInt>& k, const vector<Point>& points, int threads) {
+	if (k.size() != points.size()) {
+		throw "ValueError";
 	}
-	else {
-		return Point(x, -y);
+	vector<vector<unsigned int>> scalars;
+	vector<Jacobian> bases;
+	long long bits = 0;
+	for (size_t i = 0; i < k.size(); i++) {
+		BigInt ki = k[i];
+		Point pi = points[i];
+		if (ki == 0 || pi.isZero) {
+			continue;
+		}
+		if (ki < 0) {
+			ki = -ki;
+			pi = -pi;
+		}
+		bits = max(bits, ki.bitLength());
+		scalars.push_back(ki.toWords());
+		bases.push_back(toJacobian(pi));
+	}
+	if (bases.empty()) {
+		return Point(true);
+	}
+	if (bases.size() <= MSM_STRAUS_TERMS) {
+		return toAffine(mulStraus(scalars, bases, bits));
 	}
+	return toAffine(mulPippenger(scalars, bases, bits, threads));
 }
 
-BigInt Point::getX() {
-	return x;
+// x^3 + a x + b mod p
+template <class Field>
+BigInt CurveArithmetic<Field>::curveEquation(BigInt x) {
+	Element xm = f.toMont(x);
+	return f.fromMont(f.add(f.mul(xm, f.add(f.sqr(xm), aMont)), bMont));
 }
 
-BigInt Point::getY() {
-	return y;
+// a square root of x^3 + a x + b, -1 when there is none: one exponentiation in the field for p = 3 mod 4,
+// sqrtMod otherwise
+template <class Field>
+BigInt CurveArithmetic<Field>::curveSqrt(BigInt x) {
+	Element xm = f.toMont(x);
+	Element rhs = f.add(f.mul(xm, f.add(f.sqr(xm), aMont)), bMont);
+	if (sqrtExponent == 0) {
+		return sqrtMod(f.fromMont(rhs), p);
+	}
+	Element y = f.pow(rhs, sqrtExponent);
+	return f.sqr(y) == rhs ? f.fromMont(y) : BigInt(-1);
 }
 
-bool operator == (Point p1, Point p2) {
-	return p1.x == p2.x && p1.y == p2.y;
+// y^2 = x^3 + a x + b in the field, four multiplications and no reduction of BigInt
+template <class Field>
+bool CurveArithmetic<Field>::isOnCurve(Point p1) {
+	if (p1.isZero) {
+		return true;
+	}
+	Element x = f.toMont(p1.x), y = f.toMont(p1.y);
+	return f.sqr(y) == f.add(f.mul(x, f.add(f.sqr(x), aMont)), bMont);
 }
 
-bool operator != (Point p1, Point p2) {
-	return !(p1 == p2);
+// comb entries 1 .. 2^ELGAMAL_COMB_WIDTH - 1
+template <class Field>
+vector<Point> CurveArithmetic<Field>::getComb() {
+	if (comb.empty()) {
+		comb = buildComb(P);
+	}
+	vector<Point> table;
+	for (size_t j = 1; j < comb.size(); j++) {
+		table.push_back(toAffine(comb[j]));
+	}
+	return table;
 }
 
-ostream& operator << (ostream& os, Point p1) {
-	os << "(" << p1.x << ", " << p1.y << ")";
-	return os;
+// rejected, with the comb left to be built on first use, when an entry is off the curve, entry 1 is not P
+// or one comb multiplication disagrees with wNAF
+template <class Field>
+bool CurveArithmetic<Field>::setComb(const vector<Point>& table) {
+	if (table.size() + 1 != (size_t)1 << ELGAMAL_COMB_WIDTH) {
+		throw "ValueError";
+	}
+	if (table[0].isZero || table[0] != P) {
+		return false;
+	}
+	vector<Jacobian> candidate(1, infinity());
+	for (const Point& entry : table) {
+		if (entry.isZero || !isOnCurve(entry)) {
+			return false;
+		}
+		candidate.push_back(toJacobian(entry));
+	}
+	BigInt k = randBigInt(n);
+	if (toAffine(mulComb(candidate, k)) != toAffine(mulJacobian(k, P))) {
+		return false;
+	}
+	comb = candidate;
+	return true;
 }
 
 
@@ -1050,6 +5030,7 @@ ElGamal::ElGamal() {
 	b = hexToBigInt(s_b);
 	P = Point(hexToBigInt(s_g_x), hexToBigInt(s_g_y));
 	n = hexToBigInt(s_n);
+	initGroup();
 }
 
 ElGamal::ElGamal(BigInt p_, BigInt a_, BigInt b_, BigInt n_, Point P_) {
@@ -1058,21 +5039,39 @@ ElGamal::ElGamal(BigInt p_, BigInt a_, BigInt b_, BigInt n_, Point P_) {
 	b = b_;
 	n = n_;
 	P = P_;
+	initGroup();
+}
+
+// the fixed-limb field whenever p is the default modulus, whatever the rest of the curve
+void ElGamal::initGroup() {
+	if (p == FixedField<DefaultElGamalCurve>::getMod()) {
+		group = make_shared<CurveArithmetic<FixedField<DefaultElGamalCurve>>>(p, a, b, n, P);
+	}
+	else {
+		group = make_shared<CurveArithmetic<MontgomeryContext>>(p, a, b, n, P);
+	}
 }
 
 pair<Point, Point> ElGamal::encrypt(Point M, Point Y) {
 	BigInt r = 1 + randBigInt(n - 1);
-	Point d = mulPoint(r, Y);
-	Point g = mulPoint(r, P);
-	Point h = addPoints(M, d);
-	return { g, h };
+	return group->encrypt(M, Y, r);
 }
 
 Point ElGamal::decrypt(pair<Point, Point> c, BigInt k) {
-	Point s = mulPoint(k, c.first);
-	Point s1 = -s;
-	Point M = addPoints(s1, c.second);
-	return M;
+	return group->decrypt(c, k);
+}
+
+// one ephemeral key per message, drawn here so that the worker threads never touch the generator
+vector<pair<Point, Point>> ElGamal::encryptBatch(const vector<Point>& messages, Point Y, int threads) {
+	vector<BigInt> r(messages.size());
+	for (BigInt& ri : r) {
+		ri = 1 + randBigInt(n - 1);
+	}
+	return group->encryptBatch(messages, Y, r, threads);
+}
+
+vector<Point> ElGamal::decryptBatch(const vector<pair<Point, Point>>& c, BigInt k, int threads) {
+	return group->decryptBatch(c, k, threads);
 }
 // -k*g = -k*r*P + M+r*k*P
 
@@ -1104,22 +5103,54 @@ Point ElGamal::addPoints(Point p1, Point p2) {
 	return Point(xNew, yNew);
 }
 
-
+// wNAF in Jacobian coordinates (the comb for multiples of P), one inversion in the final toAffine
 Point ElGamal::mulPoint(BigInt k, Point p1) {
-	if (p1.isZero || k == 0) {
-		return Point(true);
+	return group->mul(k, p1);
+}
+
+// co-Z Montgomery ladder: the same operation sequence for every scalar
+Point ElGamal::mulPointLadder(BigInt k, Point p1) {
+	return group->mulLadder(k, p1);
+}
+
+Point ElGamal::multiScalarMul(const vector<BigInt>& k, const vector<Point>& points, int threads) {
+	return group->multiScalarMul(k, points, threads);
+}
+
+// text table: the curve and the comb width on the first line, then x y of every comb entry
+void ElGamal::saveGeneratorTable(const string& path) {
+	vector<Point> table = group->getComb();
+	ofstream out(path);
+	if (!out) {
+		throw "IOError";
 	}
-	if (k == 1) {
-		return p1;
+	out << p << " " << a << " " << b << " " << n << " " << P.x << " " << P.y << " " << ELGAMAL_COMB_WIDTH << "\n";
+	for (Point& entry : table) {
+		out << entry.x << " " << entry.y << "\n";
 	}
-	Point tmp = mulPoint(k / 2, p1);
-
-	Point ans = addPoints(tmp, tmp);
+}
 
-	if (k.mod2() == 1) {
-		ans = addPoints(ans, p1);
+// false when the file is missing, was written for another curve, generator or comb width, or fails the checks of setComb
+bool ElGamal::loadGeneratorTable(const string& path) {
+	ifstream in(path);
+	if (!in) {
+		return false;
 	}
-	return ans;
+	BigInt fp, fa, fb, fn, fx, fy;
+	int width = 0;
+	in >> fp >> fa >> fb >> fn >> fx >> fy >> width;
+	if (!in || fp != p || fa != a || fb != b || fn != n || fx != P.x || fy != P.y || width != ELGAMAL_COMB_WIDTH) {
+		return false;
+	}
+	vector<Point> table((1 << ELGAMAL_COMB_WIDTH) - 1);
+	for (Point& entry : table) {
+		BigInt x, y;
+		if (!(in >> x >> y)) {
+			return false;
+		}
+		entry = Point(x, y);
+	}
+	return group->setComb(table);
 }
 
 
@@ -1132,7 +5163,270 @@ void ElGamal::testPoint(Point p1) {
 	cout << "x                = " << p1.x << endl;
 	cout << "y                = " << p1.y << endl;
 	cout << "y^2              = " << p1.y * p1.y % p << endl;
-	// cout << "x^3 + a*x + b    = " << (p1.x.pow(3, p) + a * p1.x % p + b) % p << endl;
+	cout << "x^3 + a*x + b    = " << group->curveEquation(p1.x) << endl;
+	cout << "on curve         = " << (isOnCurve(p1) ? "yes" : "no") << endl;
+}
+
+bool ElGamal::isOnCurve(Point p1) {
+	return group->isOnCurve(p1);
+}
+
+/*
+ * point encoding
+ */
+
+// big-endian, left-padded with zeros to length bytes
+static vector<unsigned char> bigIntToBytes(const BigInt& x, size_t length) {
+	vector<unsigned int> words = x.toWords();
+	vector<unsigned char> res(length, 0);
+	for (size_t i = 0; i < length && i / 4 < words.size(); i++) {
+		res[length - 1 - i] = (unsigned char)(words[i / 4] >> (8 * (i % 4)));
+	}
+	return res;
+}
+
+static BigInt bytesToBigInt(const unsigned char* bytes, size_t length) {
+	vector<unsigned int> words((length + 3) / 4, 0);
+	for (size_t i = 0; i < length; i++) {
+		words[i / 4] |= (unsigned int)bytes[length - 1 - i] << (8 * (i % 4));
+	}
+	return BigInt::fromWords(words);
+}
+
+// SEC1: 00 for the point at infinity, 02 or 03 (the parity of y) followed by x, or 04 followed by x and y,
+// both in as many bytes as p takes
+vector<unsigned char> ElGamal::encodePoint(Point p1, bool compressed) {
+	if (p1.isZero) {
+		return { 0x00 };
+	}
+	size_t length = (p.bitLength() + 7) / 8;
+	BigInt x = p1.x.mathMod(p), y = p1.y.mathMod(p);
+	vector<unsigned char> res = { (unsigned char)(!compressed ? 0x04 : y.mod2() == 1 ? 0x03 : 0x02) };
+	vector<unsigned char> xBytes = bigIntToBytes(x, length);
+	res.insert(res.end(), xBytes.begin(), xBytes.end());
+	if (!compressed) {
+		vector<unsigned char> yBytes = bigIntToBytes(y, length);
+		res.insert(res.end(), yBytes.begin(), yBytes.end());
+	}
+	return res;
+}
+
+// throws on a malformed encoding, coordinates not below p or a point off the curve
+Point ElGamal::decodePoint(const vector<unsigned char>& bytes) {
+	size_t length = (p.bitLength() + 7) / 8;
+	if (bytes.size() == 1 && bytes[0] == 0x00) {
+		return Point(true);
+	}
+	if (bytes.size() == 1 + 2 * length && bytes[0] == 0x04) {
+		Point res(bytesToBigInt(&bytes[1], length), bytesToBigInt(&bytes[1 + length], length));
+		if (res.x >= p || res.y >= p || !isOnCurve(res)) {
+			throw "ValueError";
+		}
+		return res;
+	}
+	if (bytes.size() == 1 + length && (bytes[0] == 0x02 || bytes[0] == 0x03)) {
+		BigInt x = bytesToBigInt(&bytes[1], length);
+		if (x >= p) {
+			throw "ValueError";
+		}
+		BigInt y = group->curveSqrt(x);
+		if (y < 0) {
+			throw "ValueError";
+		}
+		if ((y.mod2() == 1) != (bytes[0] == 0x03)) {
+			if (y == 0) {
+				throw "ValueError";
+			}
+			y = p - y;
+		}
+		return Point(x, y);
+	}
+	throw "ValueError";
+}
+
+/*
+ * hashing and OAEP
+ */
+
+static const unsigned int SHA256_K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static unsigned int rotr32(unsigned int x, int n) {
+	return (x >> n) | (x << (32 - n));
+}
+
+// FIPS 180-4
+vector<unsigned char> sha256(const vector<unsigned char>& data) {
+	unsigned int state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	vector<unsigned char> padded = data;
+	padded.push_back(0x80);
+	while (padded.size() % 64 != 56) {
+		padded.push_back(0);
+	}
+	unsigned long long bitCount = (unsigned long long)data.size() * 8;
+	for (int i = 7; i >= 0; i--) {
+		padded.push_back((unsigned char)(bitCount >> (8 * i)));
+	}
+
+	for (size_t block = 0; block < padded.size(); block += 64) {
+		unsigned int w[64];
+		for (int i = 0; i < 16; i++) {
+			w[i] = (unsigned int)padded[block + 4 * i] << 24 | (unsigned int)padded[block + 4 * i + 1] << 16 |
+				(unsigned int)padded[block + 4 * i + 2] << 8 | padded[block + 4 * i + 3];
+		}
+		for (int i = 16; i < 64; i++) {
+			unsigned int s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			unsigned int s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+		unsigned int v[8];
+		for (int i = 0; i < 8; i++) {
+			v[i] = state[i];
+		}
+		for (int i = 0; i < 64; i++) {
+			unsigned int s1 = rotr32(v[4], 6) ^ rotr32(v[4], 11) ^ rotr32(v[4], 25);
+			unsigned int ch = (v[4] & v[5]) ^ (~v[4] & v[6]);
+			unsigned int t1 = v[7] + s1 + ch + SHA256_K[i] + w[i];
+			unsigned int s0 = rotr32(v[0], 2) ^ rotr32(v[0], 13) ^ rotr32(v[0], 22);
+			unsigned int maj = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+			unsigned int t2 = s0 + maj;
+			for (int j = 7; j > 0; j--) {
+				v[j] = v[j - 1];
+			}
+			v[4] += t1;
+			v[0] = t1 + t2;
+		}
+		for (int i = 0; i < 8; i++) {
+			state[i] += v[i];
+		}
+	}
+
+	vector<unsigned char> digest(32);
+	for (int i = 0; i < 32; i++) {
+		digest[i] = (unsigned char)(state[i / 4] >> (24 - 8 * (i % 4)));
+	}
+	return digest;
+}
+
+// MGF1 over SHA-256 (RFC 8017)
+static vector<unsigned char> mgf1(const vector<unsigned char>& seed, size_t length) {
+	vector<unsigned char> mask;
+	for (unsigned int counter = 0; mask.size() < length; counter++) {
+		vector<unsigned char> input = seed;
+		for (int i = 3; i >= 0; i--) {
+			input.push_back((unsigned char)(counter >> (8 * i)));
+		}
+		vector<unsigned char> digest = sha256(input);
+		mask.insert(mask.end(), digest.begin(), digest.end());
+	}
+	mask.resize(length);
+	return mask;
+}
+
+// a block is L = (bits(n) - 1) / 8 bytes, so every block is below n: maskedSeed (h) || maskedDB, with
+// DB = label hash (h) || 00 .. 00 || 01 || data. h is the full SHA-256 once that still leaves 32 data bytes
+// (blocks of 97 bytes and up); below that it is cut to a quarter of the block, so small demonstration moduli keep half
+struct OaepLayout {
+	size_t blockBytes, hashBytes, dataBytes;
+};
+
+static OaepLayout oaepLayout(const BigInt& n) {
+	OaepLayout layout;
+	layout.blockBytes = (size_t)((n.bitLength() - 1) / 8);
+	if (layout.blockBytes < 5) {
+		throw "ValueError";
+	}
+	layout.hashBytes = layout.blockBytes >= 3 * 32 + 1 ? 32 : (layout.blockBytes - 1) / 4;
+	layout.dataBytes = layout.blockBytes - 2 * layout.hashBytes - 1;
+	return layout;
+}
+
+// the label binds a block to its position and to the block count, so reordered or dropped blocks fail
+static vector<unsigned char> oaepLabelHash(size_t index, size_t count, size_t hashBytes) {
+	vector<unsigned char> label;
+	for (unsigned long long v : { (unsigned long long)index, (unsigned long long)count }) {
+		for (int i = 7; i >= 0; i--) {
+			label.push_back((unsigned char)(v >> (8 * i)));
+		}
+	}
+	vector<unsigned char> digest = sha256(label);
+	digest.resize(hashBytes);
+	return digest;
+}
+
+vector<BigInt> oaepEncodeBlocks(const string& message, const BigInt& n) {
+	OaepLayout layout = oaepLayout(n);
+	size_t count = (message.size() + layout.dataBytes - 1) / layout.dataBytes;
+	size_t dbBytes = layout.blockBytes - layout.hashBytes;
+	vector<BigInt> blocks;
+	for (size_t i = 0; i < count; i++) {
+		string chunk = message.substr(i * layout.dataBytes, layout.dataBytes);
+		vector<unsigned char> db = oaepLabelHash(i, count, layout.hashBytes);
+		db.resize(dbBytes - chunk.size() - 1, 0);
+		db.push_back(0x01);
+		db.insert(db.end(), chunk.begin(), chunk.end());
+
+		vector<unsigned char> seed(layout.hashBytes);
+		for (unsigned char& byte : seed) {
+			byte = (unsigned char)threadRandomEngine().next32();
+		}
+		vector<unsigned char> dbMask = mgf1(seed, dbBytes);
+		for (size_t j = 0; j < dbBytes; j++) {
+			db[j] ^= dbMask[j];
+		}
+		vector<unsigned char> seedMask = mgf1(db, layout.hashBytes);
+		for (size_t j = 0; j < layout.hashBytes; j++) {
+			seed[j] ^= seedMask[j];
+		}
+		seed.insert(seed.end(), db.begin(), db.end());
+		blocks.push_back(bytesToBigInt(seed.data(), seed.size()));
+	}
+	return blocks;
+}
+
+// throws on any block that does not unpad to its own position
+string oaepDecodeBlocks(const vector<BigInt>& blocks, const BigInt& n) {
+	OaepLayout layout = oaepLayout(n);
+	size_t dbBytes = layout.blockBytes - layout.hashBytes;
+	string message;
+	for (size_t i = 0; i < blocks.size(); i++) {
+		if (blocks[i] < 0 || blocks[i].bitLength() > (long long)(8 * layout.blockBytes)) {
+			throw "ValueError";
+		}
+		vector<unsigned char> bytes = bigIntToBytes(blocks[i], layout.blockBytes);
+		vector<unsigned char> seed(bytes.begin(), bytes.begin() + layout.hashBytes);
+		vector<unsigned char> db(bytes.begin() + layout.hashBytes, bytes.end());
+		vector<unsigned char> seedMask = mgf1(db, layout.hashBytes);
+		for (size_t j = 0; j < layout.hashBytes; j++) {
+			seed[j] ^= seedMask[j];
+		}
+		vector<unsigned char> dbMask = mgf1(seed, dbBytes);
+		for (size_t j = 0; j < dbBytes; j++) {
+			db[j] ^= dbMask[j];
+		}
+
+		vector<unsigned char> labelHash = oaepLabelHash(i, blocks.size(), layout.hashBytes);
+		if (!equal(labelHash.begin(), labelHash.end(), db.begin())) {
+			throw "ValueError";
+		}
+		size_t j = layout.hashBytes;
+		while (j < dbBytes && db[j] == 0) {
+			j++;
+		}
+		if (j == dbBytes || db[j] != 0x01) {
+			throw "ValueError";
+		}
+		message.append(db.begin() + j + 1, db.end());
+	}
+	return message;
 }
 
 bool psw_prime(BigInt n) {
@@ -1242,18 +5536,9 @@ BigInt rand_num_fixed_bits(int n) {
 	if (n == 2) {
 		return 2;
 	}
-	int *bits=new int[n];
-	bits[0] = 1;
-	bits[n - 1] = 1;
-	for (int i = 1; i + 1 < n; i++) {
-		bits[i] = rand() % 2;
-	}
-
-	BigInt rnd = 0;
-	BigInt pw2 = 1;
-	for (int i = 0; i < n; i++) {
-		rnd = rnd + pw2 * bits[i];
-		pw2 = pw2 * 2;
+	BigInt rnd = threadRandomEngine().fixedBits(n);
+	if (rnd.mod2() == 0) {
+		rnd = rnd + 1;
 	}
 	return rnd;
 }
@@ -1274,6 +5559,132 @@ BigInt rand_prime_fixed_bits(int n) {
 	return rnd;
 }
 
+static const int PRIME_SIEVE_LIMIT = 1 << 16;
+static const int PRIME_SIEVE_WINDOW = 1 << 12;
+static const int PRIME_TEST_ROUNDS = 20;
+
+vector<int> smallPrimes(int limit) {
+	vector<bool> composite(limit + 1, false);
+	vector<int> primes;
+	for (long long i = 2; i <= limit; i++) {
+		if (composite[i]) {
+			continue;
+		}
+		primes.push_back((int)i);
+		for (long long j = i * i; j <= limit; j += i) {
+			composite[j] = true;
+		}
+	}
+	return primes;
+}
+
+// marks k for which start + k * step (and 2 * (start + k * step) + 1 when safe) has a small factor,
+// candidates are expected to exceed PRIME_SIEVE_LIMIT
+static vector<bool> sieveProgression(const BigInt& start, const BigInt& step, bool safe) {
+	static const vector<int> primes = smallPrimes(PRIME_SIEVE_LIMIT);
+	vector<bool> composite(PRIME_SIEVE_WINDOW, false);
+	for (int r : primes) {
+		long long s = start.modSmall(r);
+		long long d = step.modSmall(r);
+		if (d == 0) {
+			if (s == 0 || (safe && (2 * s + 1) % r == 0)) {
+				return vector<bool>(PRIME_SIEVE_WINDOW, true);
+			}
+			continue;
+		}
+		long long dInv = inverseModSmall(d, r);
+		for (long long k = (r - s) % r * dInv % r; k < PRIME_SIEVE_WINDOW; k += r) {
+			composite[k] = true;
+		}
+		if (safe && r != 2) {
+			for (long long k = ((r - 1) / 2 - s + r) % r * dInv % r; k < PRIME_SIEVE_WINDOW; k += r) {
+				composite[k] = true;
+			}
+		}
+	}
+	return composite;
+}
+
+static bool isSieveSurvivorPrime(const BigInt& x, bool safe) {
+	if (!testPrimeFermat(x, MontgomeryContext(x))) {
+		return false;
+	}
+	if (!safe) {
+		return testPrimeMillerRabin(x, PRIME_TEST_ROUNDS);
+	}
+	BigInt p = 2 * x + 1;
+	if (p.modSmall(3) == 0 || !testPrimeFermat(p, MontgomeryContext(p))) {
+		return false;
+	}
+	// Pocklington: with x prime, 2^(p-1) = 1 (mod p) and 3 not dividing p already prove p prime
+	return testPrimeMillerRabin(x, PRIME_TEST_ROUNDS);
+}
+
+// first prime x = start + k * step below limit (x with 2x + 1 also prime when safe), -1 if none
+static BigInt findPrimeInProgression(BigInt start, const BigInt& step, const BigInt& limit, bool safe) {
+	bool useSieve = start > PRIME_SIEVE_LIMIT;
+	while (start < limit) {
+		vector<bool> composite = useSieve ? sieveProgression(start, step, safe) : vector<bool>(PRIME_SIEVE_WINDOW, false);
+		BigInt x = start;
+		for (int k = 0; k < PRIME_SIEVE_WINDOW; k++, x = x + step) {
+			if (x >= limit) {
+				return -1;
+			}
+			if (!composite[k] && isSieveSurvivorPrime(x, safe)) {
+				return x;
+			}
+		}
+		start = x;
+	}
+	return -1;
+}
+
+// p = 2q + 1 with q prime, both sieved together over one window of q
+BigInt rand_safe_prime_fixed_bits(int n) {
+	if (n < 16) {
+		throw "ValueError";
+	}
+	BigInt limit = BigInt(2).pow(n - 1);
+	while (true) {
+		BigInt q = findPrimeInProgression(rand_num_fixed_bits(n - 1), 2, limit, true);
+		if (q != -1) {
+			return 2 * q + 1;
+		}
+	}
+}
+
+// Gordon's algorithm: p - 1 has the prime factor r, p + 1 has the prime factor s, r - 1 has the prime factor t
+BigInt rand_strong_prime_fixed_bits(int n) {
+	if (n < 64) {
+		throw "ValueError";
+	}
+	int halfBits = n / 2 - max(16, n / 8);
+	BigInt halfLimit = BigInt(2).pow(halfBits);
+	BigInt low = BigInt(2).pow(n - 1);
+	BigInt high = low * 2;
+	while (true) {
+		BigInt s = findPrimeInProgression(rand_num_fixed_bits(halfBits), 2, halfLimit, false);
+		BigInt t = findPrimeInProgression(rand_num_fixed_bits(halfBits), 2, halfLimit, false);
+		if (s == -1 || t == -1 || s == t) {
+			continue;
+		}
+
+		BigInt i0 = threadRandomEngine().fixedBits(8);
+		BigInt r = findPrimeInProgression(2 * i0 * t + 1, 2 * t, halfLimit * 65536, false);
+		if (r == -1 || r == s) {
+			continue;
+		}
+
+		BigInt p0 = 2 * reverse_modulo(s, r) * s - 1;
+		BigInt step = 2 * r * s;
+		BigInt j0 = (low - p0) / step + 1 + randBigInt((high - low) / step / 2);
+		BigInt p = findPrimeInProgression(p0 + j0 * step, step, high, false);
+		if (p != -1) {
+			return p;
+		}
+	}
+}
+
 string BigInt::present_as_base(int base) {
 	BigInt cp = *this;
 	if (cp == 0) {
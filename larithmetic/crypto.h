@@ -1,5 +1,17 @@
 #include <iostream>
 #include <vector>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 using namespace std;
 
@@ -34,6 +46,11 @@ public:
 	BigInt mathMod(BigInt mod);
 	long long getLength() const;
 	vector<long long> getDigits();
+	long long modSmall(long long m) const;
+	BigInt divSmall(long long m) const;
+	long long bitLength() const;
+	vector<unsigned int> toWords() const;
+	static BigInt fromWords(const vector<unsigned int>& words);
 
 	friend ostream& operator << (ostream& os, BigInt bigInt);
 	friend istream& operator >> (istream& is, BigInt& bigInt);
@@ -108,33 +125,592 @@ public:
 };
 
 
+typedef vector<unsigned int> MontgomeryForm;
+
+// arithmetic modulo an odd number in Montgomery form, R = 2^(32 * k)
+class MontgomeryContext {
+private:
+	BigInt mod;
+	int k;
+	MontgomeryForm m;
+	unsigned int mInv;
+	MontgomeryForm r2;
+	MontgomeryForm one;
+	long long groupLimbs;
+	MontgomeryForm groupShift;
+
+public:
+	typedef MontgomeryForm Element;
+
+	MontgomeryContext(BigInt mod_);
+
+	MontgomeryForm toMont(BigInt a) const;
+	BigInt fromMont(const MontgomeryForm& a) const;
+	BigInt reduce(BigInt a) const;
+
+	MontgomeryForm mul(const MontgomeryForm& a, const MontgomeryForm& b) const;
+	MontgomeryForm sqr(const MontgomeryForm& a) const;
+	MontgomeryForm add(const MontgomeryForm& a, const MontgomeryForm& b) const;
+	MontgomeryForm sub(const MontgomeryForm& a, const MontgomeryForm& b) const;
+	MontgomeryForm pow(const MontgomeryForm& a, const BigInt& n) const;
+	BigInt powMod(BigInt a, BigInt n) const;
+
+	MontgomeryForm getOne() const;
+	MontgomeryForm getZero() const;
+	BigInt getMod() const;
+};
+
+
+// product of bases_i^exponents_i mod m over one shared chain of squarings
+BigInt multiPowMod(const vector<BigInt>& bases, const vector<BigInt>& exponents, BigInt mod);
+
+// 64 x 64 -> 128 bit product: the low word is returned, the high one goes to hi
+inline unsigned long long mulWide(unsigned long long a, unsigned long long b, unsigned long long& hi) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return _umul128(a, b, &hi);
+#elif defined(__SIZEOF_INT128__)
+	unsigned __int128 v = (unsigned __int128)a * b;
+	hi = (unsigned long long)(v >> 64);
+	return (unsigned long long)v;
+#else
+	unsigned long long aLo = a & 0xffffffff, aHi = a >> 32, bLo = b & 0xffffffff, bHi = b >> 32;
+	unsigned long long ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo;
+	unsigned long long mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+	hi = aHi * bHi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+	return (mid << 32) | (ll & 0xffffffff);
+#endif
+}
+
+// a + b + carry, the carry out (0 or 1) replaces carry
+inline unsigned long long addCarry(unsigned long long a, unsigned long long b, unsigned long long& carry) {
+	unsigned long long s = a + carry;
+	unsigned long long c = s < carry;
+	s += b;
+	carry = c + (s < b);
+	return s;
+}
+
+// a - b - borrow, the borrow out (0 or 1) replaces borrow
+inline unsigned long long subBorrow(unsigned long long a, unsigned long long b, unsigned long long& borrow) {
+	unsigned long long d = a - b;
+	unsigned long long c = a < b;
+	c += d < borrow;
+	d -= borrow;
+	borrow = c;
+	return d;
+}
+
+template <int LIMBS>
+struct FixedLimbs {
+	unsigned long long w[LIMBS];
+
+	bool operator == (const FixedLimbs& other) const {
+		unsigned long long diff = 0;
+		for (int i = 0; i < LIMBS; i++) {
+			diff |= w[i] ^ other.w[i];
+		}
+		return diff == 0;
+	}
+	bool operator != (const FixedLimbs& other) const {
+		return !(*this == other);
+	}
+};
+
+// the modulus of a Curve as limbs, least significant first
+template <class Curve>
+constexpr FixedLimbs<Curve::LIMBS> fixedModulus() {
+	FixedLimbs<Curve::LIMBS> m = {};
+	for (int i = 0; i < Curve::LIMBS; i++) {
+		m.w[i] = Curve::modulusWord(i);
+	}
+	return m;
+}
+
+// -p^-1 mod 2^64, Newton's iteration doubles the number of correct low bits every step
+template <class Curve>
+constexpr unsigned long long fixedNegInverse() {
+	unsigned long long p0 = Curve::modulusWord(0), inv = 1;
+	for (int i = 0; i < 6; i++) {
+		inv *= 2 - p0 * inv;
+	}
+	return 0 - inv;
+}
+
+// 2^count mod p by doubling, R = 2^(64 LIMBS) and R^2 for the conversions
+template <class Curve>
+constexpr FixedLimbs<Curve::LIMBS> fixedPowerOfTwo(int count) {
+	FixedLimbs<Curve::LIMBS> x = {}, m = fixedModulus<Curve>();
+	x.w[0] = 1;
+	for (int i = 0; i < count; i++) {
+		unsigned long long carry = 0;
+		for (int j = 0; j < Curve::LIMBS; j++) {
+			unsigned long long v = x.w[j];
+			x.w[j] = (v << 1) | carry;
+			carry = v >> 63;
+		}
+		bool less = carry == 0;
+		for (int j = Curve::LIMBS - 1; less && j >= 0; j--) {
+			if (x.w[j] != m.w[j]) {
+				less = x.w[j] < m.w[j];
+				break;
+			}
+			less = j != 0;
+		}
+		if (!less) {
+			unsigned long long borrow = 0;
+			for (int j = 0; j < Curve::LIMBS; j++) {
+				unsigned long long d = x.w[j] - m.w[j] - borrow;
+				borrow = x.w[j] < m.w[j] || (x.w[j] == m.w[j] && borrow);
+				x.w[j] = d;
+			}
+		}
+	}
+	return x;
+}
+
+// GF(p) for a p known at compile time, Curve::LIMBS 64-bit limbs in Montgomery form with R = 2^(64 LIMBS);
+// the reduction constants are computed by the compiler and every result is selected by masks, not branches.
+// Same interface as MontgomeryContext, so the curve code takes either
+template <class Curve>
+class FixedField {
+public:
+	static const int LIMBS = Curve::LIMBS;
+	typedef FixedLimbs<LIMBS> Element;
+
+private:
+	static constexpr Element MOD = fixedModulus<Curve>();
+	static constexpr unsigned long long M_INV = fixedNegInverse<Curve>();
+	static constexpr Element ONE = fixedPowerOfTwo<Curve>(64 * LIMBS);
+	static constexpr Element R2 = fixedPowerOfTwo<Curve>(128 * LIMBS);
+
+	// x - p when x (with the extra top word) is at least p, x otherwise
+	static Element reduceOnce(const Element& x, unsigned long long top);
+
+public:
+	FixedField(BigInt mod_);
+
+	Element toMont(BigInt a) const;
+	BigInt fromMont(const Element& a) const;
+
+	Element mul(const Element& a, const Element& b) const;
+	Element sqr(const Element& a) const;
+	Element add(const Element& a, const Element& b) const;
+	Element sub(const Element& a, const Element& b) const;
+	Element pow(const Element& a, const BigInt& n) const;
+
+	Element getOne() const;
+	Element getZero() const;
+	static BigInt getMod();
+};
+
+template <class Curve> constexpr typename FixedField<Curve>::Element FixedField<Curve>::MOD;
+template <class Curve> constexpr unsigned long long FixedField<Curve>::M_INV;
+template <class Curve> constexpr typename FixedField<Curve>::Element FixedField<Curve>::ONE;
+template <class Curve> constexpr typename FixedField<Curve>::Element FixedField<Curve>::R2;
+
+template <class Curve>
+FixedField<Curve>::FixedField(BigInt mod_) {
+	if (mod_ != getMod()) {
+		throw "ValueError";
+	}
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::reduceOnce(const Element& x, unsigned long long top) {
+	Element d;
+	unsigned long long borrow = 0;
+	for (int i = 0; i < LIMBS; i++) {
+		d.w[i] = subBorrow(x.w[i], MOD.w[i], borrow);
+	}
+	subBorrow(top, 0, borrow);
+	// borrow is 1 exactly when x < p
+	unsigned long long keep = 0 - borrow;
+	Element res;
+	for (int i = 0; i < LIMBS; i++) {
+		res.w[i] = (x.w[i] & keep) | (d.w[i] & ~keep);
+	}
+	return res;
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::toMont(BigInt a) const {
+	BigInt mod = getMod();
+	if (a < 0 || a >= mod) {
+		a = a.mathMod(mod);
+	}
+	vector<unsigned int> words = a.toWords();
+	Element x = {};
+	for (size_t i = 0; i < words.size(); i++) {
+		x.w[i / 2] |= (unsigned long long)words[i] << (32 * (i % 2));
+	}
+	return mul(x, R2);
+}
+
+template <class Curve>
+BigInt FixedField<Curve>::fromMont(const Element& a) const {
+	Element unit = {};
+	unit.w[0] = 1;
+	Element x = mul(a, unit);
+	vector<unsigned int> words(2 * LIMBS);
+	for (int i = 0; i < LIMBS; i++) {
+		words[2 * i] = (unsigned int)x.w[i];
+		words[2 * i + 1] = (unsigned int)(x.w[i] >> 32);
+	}
+	return BigInt::fromWords(words);
+}
+
+// CIOS: one limb of b multiplied in and one limb reduced away per round
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::mul(const Element& a, const Element& b) const {
+	unsigned long long t[LIMBS + 2] = {};
+	for (int i = 0; i < LIMBS; i++) {
+		unsigned long long carry = 0;
+		for (int j = 0; j < LIMBS; j++) {
+			unsigned long long hi, c = 0;
+			unsigned long long lo = mulWide(a.w[j], b.w[i], hi);
+			t[j] = addCarry(t[j], lo, c);
+			hi += c;
+			c = 0;
+			t[j] = addCarry(t[j], carry, c);
+			carry = hi + c;
+		}
+		unsigned long long c = 0;
+		t[LIMBS] = addCarry(t[LIMBS], carry, c);
+		t[LIMBS + 1] = c;
+
+		unsigned long long m = t[0] * M_INV;
+		unsigned long long hi, lo = mulWide(m, MOD.w[0], hi);
+		c = 0;
+		addCarry(t[0], lo, c);
+		carry = hi + c;
+		for (int j = 1; j < LIMBS; j++) {
+			lo = mulWide(m, MOD.w[j], hi);
+			c = 0;
+			t[j - 1] = addCarry(t[j], lo, c);
+			hi += c;
+			c = 0;
+			t[j - 1] = addCarry(t[j - 1], carry, c);
+			carry = hi + c;
+		}
+		c = 0;
+		t[LIMBS - 1] = addCarry(t[LIMBS], carry, c);
+		t[LIMBS] = t[LIMBS + 1] + c;
+	}
+	Element x;
+	for (int i = 0; i < LIMBS; i++) {
+		x.w[i] = t[i];
+	}
+	return reduceOnce(x, t[LIMBS]);
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::sqr(const Element& a) const {
+	return mul(a, a);
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::add(const Element& a, const Element& b) const {
+	Element s;
+	unsigned long long carry = 0;
+	for (int i = 0; i < LIMBS; i++) {
+		s.w[i] = addCarry(a.w[i], b.w[i], carry);
+	}
+	return reduceOnce(s, carry);
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::sub(const Element& a, const Element& b) const {
+	Element d;
+	unsigned long long borrow = 0;
+	for (int i = 0; i < LIMBS; i++) {
+		d.w[i] = subBorrow(a.w[i], b.w[i], borrow);
+	}
+	unsigned long long mask = 0 - borrow, carry = 0;
+	for (int i = 0; i < LIMBS; i++) {
+		d.w[i] = addCarry(d.w[i], MOD.w[i] & mask, carry);
+	}
+	return d;
+}
+
+// fixed 4-bit window over the binary digits of n
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::pow(const Element& a, const BigInt& n) const {
+	if (n < 0) {
+		throw "ValueError";
+	}
+	vector<unsigned int> bits = n.toWords();
+	Element table[16];
+	table[0] = ONE;
+	for (int i = 1; i < 16; i++) {
+		table[i] = mul(table[i - 1], a);
+	}
+
+	Element res = ONE;
+	bool started = false;
+	for (long long i = (long long)bits.size() - 1; i >= 0; i--) {
+		for (int shift = 28; shift >= 0; shift -= 4) {
+			int nibble = (bits[i] >> shift) & 15;
+			if (started) {
+				for (int j = 0; j < 4; j++) {
+					res = sqr(res);
+				}
+				if (nibble != 0) {
+					res = mul(res, table[nibble]);
+				}
+			}
+			else if (nibble != 0) {
+				res = table[nibble];
+				started = true;
+			}
+		}
+	}
+	return res;
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::getOne() const {
+	return ONE;
+}
+
+template <class Curve>
+typename FixedField<Curve>::Element FixedField<Curve>::getZero() const {
+	return Element{};
+}
+
+template <class Curve>
+BigInt FixedField<Curve>::getMod() {
+	vector<unsigned int> words(2 * LIMBS);
+	for (int i = 0; i < LIMBS; i++) {
+		words[2 * i] = (unsigned int)MOD.w[i];
+		words[2 * i + 1] = (unsigned int)(MOD.w[i] >> 32);
+	}
+	return BigInt::fromWords(words);
+}
+
+// secp112r1, the default curve of ElGamal: p = (2^128 - 3) / 76439
+struct DefaultElGamalCurve {
+	static const int LIMBS = 2;
+	static constexpr unsigned long long modulusWord(int i) {
+		return i == 0 ? 0x5E668076BEAD208Bull : 0x0000DB7C2ABF62E3ull;
+	}
+};
+
+
+struct BarrettReducer;
+
+// residues modulo a fixed set of pairwise coprime moduli back to x mod their product: Garner for a few
+// moduli, a product tree for many
+class CrtContext {
+private:
+	vector<BigInt> moduli;
+	vector<shared_ptr<MontgomeryContext>> reducers;
+	vector<vector<BigInt>> tree;
+	BigInt product;
+	shared_ptr<BarrettReducer> productReducer;
+	vector<BigInt> constants;
+	vector<BigInt> prefixProducts;
+
+	BigInt reduce(const BigInt& x, long long i) const;
+
+public:
+	CrtContext(const vector<BigInt>& moduli_);
+
+	BigInt reconstruct(const vector<BigInt>& residues) const;
+	vector<BigInt> reconstruct(const vector<vector<BigInt>>& residues, int threads = 0) const;
+	BigInt getProduct() const;
+	const vector<BigInt>& getModuli() const;
+};
+
+// the RSA private operation c^d mod pq: c^(d mod (p - 1)) mod p on a second thread, c^(d mod (q - 1)) mod q on
+// this one, recombined by a CrtContext over {q, p}
+class RsaCrtContext {
+private:
+	BigInt dP, dQ;
+	shared_ptr<MontgomeryContext> montP, montQ;
+	shared_ptr<CrtContext> crt;
+
+public:
+	RsaCrtContext(BigInt p, BigInt q, const BigInt& d);
+
+	BigInt decrypt(const BigInt& c) const;
+};
+
+pair<BigInt, BigInt> solveSimpleSystem(vector< vector<BigInt> > sys);
+
 BigInt gcd(BigInt a, BigInt b);
+BigInt binaryGcd(BigInt a, BigInt b);
+vector<BigInt> batchGcd(const vector<BigInt>& moduli, int threads = 0);
+vector<BigInt> batchGcd(istream& input, int threads = 0, size_t chunkSize = 1 << 14);
 
 BigInt randBigInt(BigInt p);
+BigInt rand_num_fixed_bits(int n);
+
+class RandomEngine {
+private:
+	static const int BLOCKS_PER_REFILL = 4;
+	static const int BUFFER_WORDS = 16 * BLOCKS_PER_REFILL;
+
+	unsigned int key[8];
+	unsigned int nonce[3];
+	unsigned int counter;
+	unsigned int buffer[BUFFER_WORDS];
+	int position;
+
+	int powerBits;
+	BigInt powerOfTwo;
+
+	void refill();
+
+public:
+	RandomEngine();
+	RandomEngine(const vector<unsigned int>& key_, const vector<unsigned int>& nonce_ = {}, unsigned int counter_ = 0);
+
+	unsigned int next32();
+	unsigned long long next64();
+	long long nextLimb();
+	void fillLimbs(vector<long long>& limbs);
+	long long uniformBelow(long long bound);
+	BigInt uniformBelow(BigInt bound);
+	BigInt fixedBits(int n);
+};
+
+RandomEngine& threadRandomEngine();
+
+class ThreadPool {
+private:
+	vector<thread> workers;
+	queue<function<void()>> tasks;
+	mutex lock;
+	condition_variable taskAvailable;
+	condition_variable tasksDone;
+	int running;
+	bool stopping;
+	exception_ptr error;
+
+	void workerLoop();
+
+public:
+	ThreadPool(int threads);
+	~ThreadPool();
+
+	void submit(function<void()> task);
+	void wait();
+	int size() const;
+};
+
+int defaultThreadCount();
 
 // BigInt rhoPollard(BigInt n, BigInt iterationsCount);
 BigInt fPollard(BigInt a, BigInt mod);
+BigInt rhoPollardDivisor(BigInt n, long long iterationsCount, BigInt c, const atomic<bool>* stop = nullptr);
+
+struct EcmLevel {
+	long long B1;
+	long long B2;
+	int curves;
+};
+
+// stages tried in order by findDivisor: Pollard p-1, ECM levels, SIQS, Pollard rho; a zero B1 skips p-1
+// from siqsMinBits on only the first siqsEcmLevels ECM levels run before SIQS, zero disables SIQS
+struct FactorizationConfig {
+	long long pm1B1 = 10000;
+	long long pm1B2 = 1000000;
+	vector<EcmLevel> ecmLevels = { { 2000, 200000, 25 }, { 11000, 1100000, 90 }, { 50000, 5000000, 300 } };
+	int siqsMinBits = 100;
+	int siqsEcmLevels = 1;
+	int siqsThreads = 0;
+	long long rhoRetry = 10;
+	int rhoOnlyBits = 40;
+};
+
+BigInt pollardPM1Divisor(BigInt n, long long B1, long long B2);
+BigInt ecmDivisor(BigInt n, long long B1, long long B2, int curves);
+BigInt siqsDivisor(BigInt n, int threads = 0);
+BigInt findDivisor(BigInt n, const FactorizationConfig& config);
 BigInt getDivisor(BigInt n, long long countRetry);
+BigInt getDivisor(BigInt n, const FactorizationConfig& config);
 vector<pair<BigInt, BigInt>> rhoPollardFactorization(BigInt n);
+vector<pair<BigInt, BigInt>> rhoPollardFactorization(BigInt n, const FactorizationConfig& config);
 pair<BigInt, BigInt> factorization2Primes(BigInt n, long long countRetry);
+pair<BigInt, BigInt> factorization2Primes(BigInt n, const FactorizationConfig& config);
+vector<pair<BigInt, BigInt>> parallelFactorization(BigInt n, int threads = 0, const FactorizationConfig& config = FactorizationConfig());
 bool psw_prime(BigInt n);
 BigInt get_lucas_seq_element(BigInt n, int Q, int D);
 
 BigInt babyStepGiantStepLog(BigInt a, BigInt b, BigInt p);
+BigInt babyStepGiantStepLog(BigInt a, BigInt b, BigInt p, BigInt order, size_t memoryLimit = (size_t)256 << 20);
+BigInt rhoPollardLog(BigInt g, BigInt h, BigInt p, BigInt order, int threads = 0);
+BigInt kangarooLog(BigInt g, BigInt h, BigInt p, BigInt lower, BigInt upper, int threads = 0);
+
+// n = product of primes[i].first ^ primes[i].second, primes ascending; n = 1 has no primes
+struct Factorization {
+	BigInt n;
+	vector<pair<BigInt, BigInt>> primes;
+};
+
+// size-bounded LRU map from n to its factorization, safe to share between threads
+class FactorizationCache {
+private:
+	size_t capacity;
+	FactorizationConfig config;
+	mutex lock;
+	list<Factorization> entries;
+	map<BigInt, list<Factorization>::iterator> index;
+	size_t hitCount;
+
+public:
+	FactorizationCache(size_t capacity_ = 4096, const FactorizationConfig& config_ = FactorizationConfig());
+
+	Factorization get(BigInt n);
+	void clear();
+	size_t size();
+	// gets answered from the cache since construction
+	size_t hits();
+};
+
+FactorizationCache& sharedFactorizationCache();
+Factorization factorize(BigInt n);
 
 BigInt euler(BigInt n);
+BigInt euler(const Factorization& f);
 BigInt mobius(BigInt n);
+BigInt mobius(const Factorization& f);
+BigInt carmichael(BigInt n);
+BigInt carmichael(const Factorization& f);
+BigInt divisorCount(const Factorization& f);
+BigInt divisorSum(const Factorization& f, long long k = 1);
+
+BigInt pohligHellmanLog(BigInt g, BigInt h, BigInt p, int threads = 0);
+BigInt pohligHellmanLog(BigInt g, BigInt h, BigInt p, const Factorization& order, int threads = 0);
+
+// receives values for first, first + 1, ...; called from several threads at once when the sieve is parallel
+typedef function<void(long long first, const vector<long long>& values)> RangeCallback;
+
+void eulerRange(long long from, long long to, const RangeCallback& callback, int threads = 0);
+void mobiusRange(long long from, long long to, const RangeCallback& callback, int threads = 0);
+void smallestPrimeFactorRange(long long from, long long to, const RangeCallback& callback, int threads = 0);
+vector<long long> eulerRange(long long from, long long to);
+vector<long long> mobiusRange(long long from, long long to);
+vector<long long> smallestPrimeFactorRange(long long from, long long to);
 
 BigInt legendre(BigInt n, BigInt p);
 BigInt jacobi(BigInt n, BigInt m);
+int kronecker(BigInt a, BigInt n);
 
 BigInt rand_prime_fixed_bits(int n);
+BigInt rand_safe_prime_fixed_bits(int n);
+BigInt rand_strong_prime_fixed_bits(int n);
+vector<int> smallPrimes(int limit);
+bool testPrimeFermat(const BigInt& n, const MontgomeryContext& ctx);
 
 BigInt gcd_extended(BigInt a, BigInt b, BigInt* x, BigInt* y);
 BigInt reverse_modulo(BigInt a, BigInt m);
 
 
-// pair<BigInt, BigInt> cipolla(BigInt a, BigInt p, long long countRetry);
+pair<BigInt, BigInt> cipolla(BigInt a, BigInt p, long long countRetry = 64);
+pair<BigInt, BigInt> cipolla(BigInt a, BigInt p, const MontgomeryContext& ctx, long long countRetry = 64);
+BigInt sqrtMod(BigInt a, BigInt p);
+vector<BigInt> sqrtMod(const vector<BigInt>& values, BigInt p);
 
 BigInt get_lucas_seq_element(BigInt n, int Q, int D);
 vector<bool> get_element_numbers(BigInt n);
@@ -148,6 +724,7 @@ private:
 public:
 	SqrtPolynomial2(BigInt x_, BigInt y_, BigInt w_);
 	SqrtPolynomial2 pow(BigInt n, BigInt mod);
+	SqrtPolynomial2 pow(BigInt n, const MontgomeryContext& ctx);
 	BigInt getX();
 };
 
@@ -155,6 +732,14 @@ bool testPrimeMillerRabin(BigInt a, long long countRetry);
 
 BigInt hexToBigInt(string s);
 
+vector<unsigned char> sha256(const vector<unsigned char>& data);
+
+// OAEP-style padding (SHA-256, MGF1) of a message into as few integers below n as the padding allows, and back
+vector<BigInt> oaepEncodeBlocks(const string& message, const BigInt& n);
+string oaepDecodeBlocks(const vector<BigInt>& blocks, const BigInt& n);
+
+template <class Field> class CurveArithmetic;
+
 class Point {
 private:
 	BigInt x, y;
@@ -174,6 +759,28 @@ public:
 	friend ostream& operator << (ostream& os, Point bigInt);
 
 	friend class ElGamal;
+	template <class Field> friend class CurveArithmetic;
+};
+
+
+// point arithmetic behind ElGamal: CurveArithmetic<FixedField<DefaultElGamalCurve>> on the default curve,
+// CurveArithmetic<MontgomeryContext> on any other
+class CurveGroup {
+public:
+	virtual ~CurveGroup() {}
+	virtual Point mul(BigInt k, Point p1) = 0;
+	virtual Point mulLadder(BigInt k, Point p1) = 0;
+	virtual pair<Point, Point> encrypt(Point M, Point Y, BigInt r) = 0;
+	virtual Point decrypt(pair<Point, Point> c, BigInt k) = 0;
+	virtual vector<pair<Point, Point>> encryptBatch(const vector<Point>& messages, Point Y, const vector<BigInt>& r,
+		int threads) = 0;
+	virtual vector<Point> decryptBatch(const vector<pair<Point, Point>>& c, BigInt k, int threads) = 0;
+	virtual Point multiScalarMul(const vector<BigInt>& k, const vector<Point>& points, int threads) = 0;
+	virtual BigInt curveEquation(BigInt x) = 0;
+	virtual BigInt curveSqrt(BigInt x) = 0;
+	virtual bool isOnCurve(Point p1) = 0;
+	virtual vector<Point> getComb() = 0;
+	virtual bool setComb(const vector<Point>& table) = 0;
 };
 
 
@@ -183,14 +790,26 @@ private:
 	BigInt a, b;
 	BigInt n;
 	Point P;
+	shared_ptr<CurveGroup> group;
+
+	void initGroup();
 public:
 	ElGamal();
 	ElGamal(BigInt p_, BigInt a_, BigInt b_, BigInt n_, Point P_);
 	pair<Point, Point> encrypt(Point M, Point Y);
 	Point decrypt(pair<Point, Point> c, BigInt k);
+	vector<pair<Point, Point>> encryptBatch(const vector<Point>& messages, Point Y, int threads = 0);
+	vector<Point> decryptBatch(const vector<pair<Point, Point>>& c, BigInt k, int threads = 0);
 	Point addPoints(Point p1, Point p2);
 	Point mulPoint(BigInt k, Point p1);
+	Point mulPointLadder(BigInt k, Point p1);
+	Point multiScalarMul(const vector<BigInt>& k, const vector<Point>& points, int threads = 0);
 	Point getP();
+	bool isOnCurve(Point p1);
+	vector<unsigned char> encodePoint(Point p1, bool compressed = true);
+	Point decodePoint(const vector<unsigned char>& bytes);
+	void saveGeneratorTable(const string& path);
+	bool loadGeneratorTable(const string& path);
 	void testPoint(Point p1);
 	// Point getRandomPointOnCurve(long long countRetry);
 	BigInt getRandomSecretKey();